@@ -6,6 +6,8 @@
 #include <cstdlib>
 #include <cstdint>
 #include <algorithm>
+#include <limits>
+#include <stdexcept>
 #include "bst.h"
 
 struct KeyError { };
@@ -14,26 +16,30 @@ struct KeyError { };
 * A special kind of node for an AVL tree, which adds the balance as a data member, plus
 * other additional helper functions. You do NOT need to implement any functionality or
 * add additional data members or helper functions.
+* Like Node, it takes the concrete node type as Derived so that nodes
+* carrying extra per-subtree data (CountedAVLNode) can build on it.
 */
-template <typename Key, typename Value>
-class AVLNode : public Node<Key, Value>
+template <typename Key, typename Value, typename Derived = void>
+class AVLNode : public Node<Key, Value, typename NodeSelf<AVLNode<Key, Value, Derived>, Derived>::type>
 {
 public:
+    typedef typename NodeSelf<AVLNode, Derived>::type NodeType;
+
     // Constructor/destructor.
-    AVLNode(const Key& key, const Value& value, AVLNode<Key, Value>* parent);
-    virtual ~AVLNode();
+    AVLNode(const Key& key, const Value& value, NodeType* parent);
+    template<typename... Args>
+    AVLNode(EmplaceTag tag, NodeType* parent, Args&&... args);
+    AVLNode(const AVLNode&) = default;
+    AVLNode(AVLNode&&) = default;
+    ~AVLNode();
 
     // Getter/setter for the node's height.
     int8_t getBalance () const;
     void setBalance (int8_t balance);
     void updateBalance(int8_t diff);
 
-    // Getters for parent, left, and right. These need to be redefined since they
-    // return pointers to AVLNodes - not plain Nodes. See the Node class in bst.h
-    // for more information.
-    virtual AVLNode<Key, Value>* getParent() const override;
-    virtual AVLNode<Key, Value>* getLeft() const override;
-    virtual AVLNode<Key, Value>* getRight() const override;
+    // The getters for parent, left, and right are inherited from Node and
+    // already return AVLNodes. See the Node class in bst.h for more information.
 
 protected:
     int8_t balance_;    // effectively a signed char
@@ -49,9 +55,20 @@ protected:
 * An explicit constructor to initialize the elements by calling the base class constructor and setting
 * the color to red since every new node will be red when it is first inserted.
 */
-template<class Key, class Value>
-AVLNode<Key, Value>::AVLNode(const Key& key, const Value& value, AVLNode<Key, Value> *parent) :
-    Node<Key, Value>(key, value, parent), balance_(0)
+template<class Key, class Value, class Derived>
+AVLNode<Key, Value, Derived>::AVLNode(const Key& key, const Value& value, NodeType *parent) :
+    Node<Key, Value, NodeType>(key, value, parent), balance_(0)
+{
+
+}
+
+/**
+* Builds the item in place; see Node.
+*/
+template<class Key, class Value, class Derived>
+template<typename... Args>
+AVLNode<Key, Value, Derived>::AVLNode(EmplaceTag tag, NodeType *parent, Args&&... args) :
+    Node<Key, Value, NodeType>(tag, parent, std::forward<Args>(args)...), balance_(0)
 {
 
 }
@@ -59,8 +76,8 @@ AVLNode<Key, Value>::AVLNode(const Key& key, const Value& value, AVLNode<Key, Va
 /**
 * A destructor which does nothing.
 */
-template<class Key, class Value>
-AVLNode<Key, Value>::~AVLNode()
+template<class Key, class Value, class Derived>
+AVLNode<Key, Value, Derived>::~AVLNode()
 {
 
 }
@@ -68,8 +85,8 @@ AVLNode<Key, Value>::~AVLNode()
 /**
 * A getter for the balance of a AVLNode.
 */
-template<class Key, class Value>
-int8_t AVLNode<Key, Value>::getBalance() const
+template<class Key, class Value, class Derived>
+int8_t AVLNode<Key, Value, Derived>::getBalance() const
 {
     return balance_;
 }
@@ -77,8 +94,8 @@ int8_t AVLNode<Key, Value>::getBalance() const
 /**
 * A setter for the balance of a AVLNode.
 */
-template<class Key, class Value>
-void AVLNode<Key, Value>::setBalance(int8_t balance)
+template<class Key, class Value, class Derived>
+void AVLNode<Key, Value, Derived>::setBalance(int8_t balance)
 {
     balance_ = balance;
 }
@@ -86,112 +103,406 @@ void AVLNode<Key, Value>::setBalance(int8_t balance)
 /**
 * Adds diff to the balance of a AVLNode.
 */
-template<class Key, class Value>
-void AVLNode<Key, Value>::updateBalance(int8_t diff)
+template<class Key, class Value, class Derived>
+void AVLNode<Key, Value, Derived>::updateBalance(int8_t diff)
 {
     balance_ += diff;
 }
 
+/*
+  -----------------------------------------------
+  End implementations for the AVLNode class.
+  -----------------------------------------------
+*/
+
 /**
-* An overridden function for getting the parent since a static_cast is necessary to make sure
-* that our node is a AVLNode.
+* An AVLNode that also counts the nodes in its subtree, which gives the
+* tree select(), rank() and countRange() in O(log n). The tree keeps the
+* counts current through refresh() (see IsAugmented in bst.h). The count
+* is 32 bits so it fits in the padding after the balance and the node is
+* no larger than an AVLNode.
 */
+template <typename Key, typename Value>
+class CountedAVLNode : public AVLNode<Key, Value, CountedAVLNode<Key, Value> >
+{
+public:
+    typedef void is_augmented;
+    typedef void counts_subtree;
+
+    CountedAVLNode(const Key& key, const Value& value, CountedAVLNode<Key, Value>* parent);
+    template<typename... Args>
+    CountedAVLNode(EmplaceTag tag, CountedAVLNode<Key, Value>* parent, Args&&... args);
+
+    size_t getCount() const;
+    void refresh();
+
+protected:
+    uint32_t count_;
+};
+
 template<class Key, class Value>
-AVLNode<Key, Value> *AVLNode<Key, Value>::getParent() const
+CountedAVLNode<Key, Value>::CountedAVLNode(const Key& key, const Value& value, CountedAVLNode<Key, Value> *parent) :
+    AVLNode<Key, Value, CountedAVLNode<Key, Value> >(key, value, parent), count_(1)
 {
-    return static_cast<AVLNode<Key, Value>*>(this->parent_);
+
+}
+
+template<class Key, class Value>
+template<typename... Args>
+CountedAVLNode<Key, Value>::CountedAVLNode(EmplaceTag tag, CountedAVLNode<Key, Value> *parent, Args&&... args) :
+    AVLNode<Key, Value, CountedAVLNode<Key, Value> >(tag, parent, std::forward<Args>(args)...), count_(1)
+{
+
 }
 
 /**
-* Overridden for the same reasons as above.
+* Number of nodes in the subtree rooted here, this one included.
 */
 template<class Key, class Value>
-AVLNode<Key, Value> *AVLNode<Key, Value>::getLeft() const
+size_t CountedAVLNode<Key, Value>::getCount() const
 {
-    return static_cast<AVLNode<Key, Value>*>(this->left_);
+    return count_;
 }
 
 /**
-* Overridden for the same reasons as above.
+* Recomputes the count from the children, whose counts must be current.
 */
 template<class Key, class Value>
-AVLNode<Key, Value> *AVLNode<Key, Value>::getRight() const
+void CountedAVLNode<Key, Value>::refresh()
 {
-    return static_cast<AVLNode<Key, Value>*>(this->right_);
+    count_ = 1 + (this->left_ != NULL ? this->left_->count_ : 0)
+               + (this->right_ != NULL ? this->right_->count_ : 0);
 }
 
+/**
+* An AVLNode that caches a summary of the items in its subtree, combined
+* by Monoid, so the tree can answer rangeAggregate() in O(log n).
+* Monoid is a class with static members:
+*
+*   typedef ... summary_type;
+*   static summary_type identity();
+*   static summary_type of(const Key& key, const Value& value);
+*   static summary_type combine(const summary_type& a, const summary_type& b);
+*
+* combine() must be associative with identity() as its neutral element.
+* SumMonoid, MinMonoid and MaxMonoid cover the common cases.
+*/
+template <typename Key, typename Value, typename Monoid>
+class AggregateAVLNode : public AVLNode<Key, Value, AggregateAVLNode<Key, Value, Monoid> >
+{
+public:
+    typedef void is_augmented;
+    typedef Monoid monoid_type;
+    typedef typename Monoid::summary_type summary_type;
 
-/*
-  -----------------------------------------------
-  End implementations for the AVLNode class.
-  -----------------------------------------------
+    AggregateAVLNode(const Key& key, const Value& value, AggregateAVLNode<Key, Value, Monoid>* parent);
+    template<typename... Args>
+    AggregateAVLNode(EmplaceTag tag, AggregateAVLNode<Key, Value, Monoid>* parent, Args&&... args);
+
+    const summary_type& getSummary() const;
+    void refresh();
+
+protected:
+    summary_type summary_;
+};
+
+template<class Key, class Value, class Monoid>
+AggregateAVLNode<Key, Value, Monoid>::AggregateAVLNode(const Key& key, const Value& value, AggregateAVLNode<Key, Value, Monoid> *parent) :
+    AVLNode<Key, Value, AggregateAVLNode<Key, Value, Monoid> >(key, value, parent),
+    summary_(Monoid::of(key, value))
+{
+
+}
+
+template<class Key, class Value, class Monoid>
+template<typename... Args>
+AggregateAVLNode<Key, Value, Monoid>::AggregateAVLNode(EmplaceTag tag, AggregateAVLNode<Key, Value, Monoid> *parent, Args&&... args) :
+    AVLNode<Key, Value, AggregateAVLNode<Key, Value, Monoid> >(tag, parent, std::forward<Args>(args)...),
+    summary_(Monoid::of(this->getKey(), this->getValue()))
+{
+
+}
+
+/**
+* The items of the subtree rooted here, combined in key order.
+*/
+template<class Key, class Value, class Monoid>
+const typename Monoid::summary_type& AggregateAVLNode<Key, Value, Monoid>::getSummary() const
+{
+    return summary_;
+}
+
+/**
+* Recomputes the summary from the children, whose summaries must be current.
+*/
+template<class Key, class Value, class Monoid>
+void AggregateAVLNode<Key, Value, Monoid>::refresh()
+{
+    summary_ = Monoid::of(this->getKey(), this->getValue());
+    if (this->left_ != NULL) summary_ = Monoid::combine(this->left_->summary_, summary_);
+    if (this->right_ != NULL) summary_ = Monoid::combine(summary_, this->right_->summary_);
+}
+
+/**
+* Sums the values; for rangeAggregate() over e.g. sizes or byte counts.
+*/
+template <typename T>
+struct SumMonoid
+{
+    typedef T summary_type;
+    static T identity() { return T(); }
+    template<typename Key>
+    static T of(const Key&, const T& value) { return value; }
+    static T combine(const T& a, const T& b) { return a + b; }
+};
+
+/**
+* The smallest value; identity() is the largest T, returned for an empty range.
+*/
+template <typename T>
+struct MinMonoid
+{
+    typedef T summary_type;
+    static T identity() { return std::numeric_limits<T>::max(); }
+    template<typename Key>
+    static T of(const Key&, const T& value) { return value; }
+    static T combine(const T& a, const T& b) { return std::min(a, b); }
+};
+
+/**
+* The largest value; identity() is the lowest T, returned for an empty range.
+*/
+template <typename T>
+struct MaxMonoid
+{
+    typedef T summary_type;
+    static T identity() { return std::numeric_limits<T>::lowest(); }
+    template<typename Key>
+    static T of(const Key&, const T& value) { return value; }
+    static T combine(const T& a, const T& b) { return std::max(a, b); }
+};
+
+/**
+* The AVL counterpart of IndexNode (see index_node.h). The balance lives in
+* the three spare bits of the node's own index word rather than in a
+* separate member, so an IndexAVLNode is no larger than an IndexNode.
+*/
+template <typename Key, typename Value>
+class IndexAVLNode : public IndexNode<Key, Value, IndexAVLNode<Key, Value> >
+{
+public:
+    IndexAVLNode(const Key& key, const Value& value, IndexAVLNode<Key, Value>* parent);
+    template<typename... Args>
+    IndexAVLNode(EmplaceTag tag, IndexAVLNode<Key, Value>* parent, Args&&... args);
+
+    int8_t getBalance () const;
+    void setBalance (int8_t balance);
+    void updateBalance(int8_t diff);
+
+private:
+    static const int BALANCE_SHIFT = 29;
+};
+
+template<class Key, class Value>
+IndexAVLNode<Key, Value>::IndexAVLNode(const Key& key, const Value& value, IndexAVLNode<Key, Value> *parent) :
+    IndexNode<Key, Value, IndexAVLNode<Key, Value> >(key, value, parent)
+{
+
+}
+
+template<class Key, class Value>
+template<typename... Args>
+IndexAVLNode<Key, Value>::IndexAVLNode(EmplaceTag tag, IndexAVLNode<Key, Value> *parent, Args&&... args) :
+    IndexNode<Key, Value, IndexAVLNode<Key, Value> >(tag, parent, std::forward<Args>(args)...)
+{
+
+}
+
+/**
+* Sign-extends the 3-bit two's complement balance, so -4..3 are representable.
+*/
+template<class Key, class Value>
+int8_t IndexAVLNode<Key, Value>::getBalance() const
+{
+    return static_cast<int8_t>(static_cast<int32_t>(this->self_) >> BALANCE_SHIFT);
+}
+
+template<class Key, class Value>
+void IndexAVLNode<Key, Value>::setBalance(int8_t balance)
+{
+    this->self_ = (this->self_ & this->INDEX_MASK) | (static_cast<uint32_t>(balance) << BALANCE_SHIFT);
+}
+
+template<class Key, class Value>
+void IndexAVLNode<Key, Value>::updateBalance(int8_t diff)
+{
+    setBalance(getBalance() + diff);
+}
+
+/**
+* The AVL counterpart of SplitNode (see split_node.h): the balance sits
+* with the key and links, and the item lives out of line.
 */
+template <typename Key, typename Value>
+class SplitAVLNode : public SplitNode<Key, Value, SplitAVLNode<Key, Value> >
+{
+public:
+    SplitAVLNode(const Key& key, std::pair<const Key, Value>* item, SplitAVLNode<Key, Value>* parent);
+
+    int8_t getBalance () const;
+    void setBalance (int8_t balance);
+    void updateBalance(int8_t diff);
+
+protected:
+    int8_t balance_;
+};
+
+template<class Key, class Value>
+SplitAVLNode<Key, Value>::SplitAVLNode(const Key& key, std::pair<const Key, Value>* item, SplitAVLNode<Key, Value> *parent) :
+    SplitNode<Key, Value, SplitAVLNode<Key, Value> >(key, item, parent), balance_(0)
+{
+
+}
+
+template<class Key, class Value>
+int8_t SplitAVLNode<Key, Value>::getBalance() const
+{
+    return balance_;
+}
+
+template<class Key, class Value>
+void SplitAVLNode<Key, Value>::setBalance(int8_t balance)
+{
+    balance_ = balance;
+}
+
+template<class Key, class Value>
+void SplitAVLNode<Key, Value>::updateBalance(int8_t diff)
+{
+    balance_ += diff;
+}
 
 
-template <class Key, class Value>
-class AVLTree : public BinarySearchTree<Key, Value>
+/**
+* Runs the two halves of an AVLTree set operation one after the other;
+* ThreadPool (thread_pool.h) runs them in parallel instead.
+*/
+struct SerialExecutor
+{
+    template<typename F, typename G>
+    void runBoth(F&& first, G&& second)
+    {
+        first();
+        second();
+    }
+};
+
+template <class Key, class Value, class Compare = std::less<Key>,
+          class NodeAlloc = NewDeleteNodeAllocator,
+          class NodeType = AVLNode<Key, Value> >
+class AVLTree : public BinarySearchTree<Key, Value, Compare, NodeAlloc, NodeType>
 {
 public:
-    virtual void insert (const std::pair<const Key, Value> &new_item); // TODO
+    typedef typename BinarySearchTree<Key, Value, Compare, NodeAlloc, NodeType>::iterator iterator;
+
+    AVLTree();
+    explicit AVLTree(const Compare& comp);
+    template<typename ForwardIt>
+    AVLTree(ForwardIt first, ForwardIt last, const Compare& comp = Compare());
+
     virtual void remove(const Key& key);  // TODO
+
+    // Both move nodes between trees rather than copying them, so they
+    // need a stateless NodeAlloc (not NodePool, SplitNodeAllocator or
+    // ArenaNodeAllocator). join() is O(log n); so is split() on a tree
+    // whose nodes count their subtrees (CountedAVLTree), while with plain
+    // AVLNodes it also counts the smaller piece to keep size() exact.
+    void split(const Key& key, AVLTree& right);
+    void join(AVLTree& right);
+
+    // Remove a run of consecutive keys with two splits and a join rather
+    // than a remove() per key; both return how many items were removed.
+    size_t removeRange(const Key& lo, const Key& hi);   // keys in [lo, hi]
+    size_t erase(iterator first, iterator last);        // items in [first, last)
+
+    // Set operations that take the nodes of other, leaving it empty, and
+    // leave the result here; of equal keys, this tree's item is kept.
+    // Executor runs independent halves; see ThreadPool (thread_pool.h).
+    void unionWith(AVLTree& other);
+    void intersectWith(AVLTree& other);
+    void differenceWith(AVLTree& other);   // keys here but not in other
+    template<typename Executor>
+    void unionWith(AVLTree& other, Executor& executor);
+    template<typename Executor>
+    void intersectWith(AVLTree& other, Executor& executor);
+    template<typename Executor>
+    void differenceWith(AVLTree& other, Executor& executor);
+    virtual void setAutoRebalance(double factor) override;   // throws unless factor is 0
+
 protected:
-    virtual void nodeSwap( AVLNode<Key,Value>* n1, AVLNode<Key,Value>* n2);
+    virtual void nodeSwap( NodeType* n1, NodeType* n2) override;
+    virtual void balanceAfterInsert(NodeType* leaf) override;
+    virtual void setBuiltBalance(NodeType* node, int balance, size_t leftCount, size_t rightCount) override;
 
     // Add helper functions here
-void insertFix(AVLNode<Key, Value>* parent, AVLNode<Key, Value>* child);
-void removeFix(AVLNode<Key, Value>* n, int8_t diff);
-void rotateLeft(AVLNode<Key, Value>* axis);
-void rotateRight(AVLNode<Key, Value>* axis);
-static AVLNode<Key, Value>* avlpredecessor(AVLNode<Key, Value>* current);
+void insertFix(NodeType* parent, NodeType* child);
+void removeFix(NodeType* n, int8_t diff);
+void rotateLeft(NodeType* axis);
+void rotateRight(NodeType* axis);
+bool growFix(NodeType* node);
+NodeType* joinWithPivot(NodeType* left, int leftHeight, NodeType* pivot, NodeType* right, int rightHeight, int& height);
+void splitSubtree(NodeType* node, int height, const Key& key, NodeType*& low, int& lowHeight, NodeType*& high, int& highHeight,
+	NodeType** match = NULL);
+NodeType* joinSubtrees(NodeType* left, int leftHeight, NodeType* right, int rightHeight, int& height);
+NodeType* detachMin(NodeType*& root, int& height);
+size_t eraseNodes(NodeType* first, NodeType* last);
+void adoptRoot(NodeType* root, size_t count, AVLTree& other);
+enum SetOperation { UNION, INTERSECTION, DIFFERENCE };
+template<typename Executor>
+NodeType* combine(SetOperation op, NodeType* a, int aHeight, NodeType* b, int bHeight, int& height, size_t& dropped,
+	Executor& executor) const;
+// below this height the halves of a set operation are not worth a task
+static const int PARALLEL_HEIGHT = 12;
+static int avlHeight(NodeType* root);
+static int childHeight(NodeType* node, int height, bool left);
 };
 
-template<class Key, class Value>
-AVLNode<Key, Value>* AVLTree<Key, Value>::avlpredecessor(AVLNode<Key, Value>* current)
+template<class Key, class Value, class Compare, class NodeAlloc, class NodeType>
+AVLTree<Key, Value, Compare, NodeAlloc, NodeType>::AVLTree()
 {
-    // TODO
-		if (current == NULL)
-		{
-			return NULL;
-		}
-		AVLNode<Key, Value>* currentcopy;
-		if (current->getLeft() != NULL)
-		{
-			current = current->getLeft();
-			currentcopy = current;
-			while (current != NULL)
-			{
-				current = current->getRight();
-				if (current != NULL)
-				{
-					currentcopy = current;
-				}
-			}
-			return currentcopy;
-		}
-		else // no left child
-		{
-			if (current->getParent() == NULL) // we've reached root since parent of current = null 
-			{
-				return NULL;
-			}
-			while(current != (current->getParent())->getRight())
-			{
-				current = current->getParent();
-				if (current->getParent() == NULL)
-				{
-					return NULL;
-				}
-			}
-			return current->getParent();
-		}
+
 }
 
+template<class Key, class Value, class Compare, class NodeAlloc, class NodeType>
+AVLTree<Key, Value, Compare, NodeAlloc, NodeType>::AVLTree(const Compare& comp) :
+    BinarySearchTree<Key, Value, Compare, NodeAlloc, NodeType>(comp)
+{
 
-template<class Key, class Value>
-void AVLTree<Key, Value>::rotateRight(AVLNode<Key, Value>* axis)
+}
+
+/**
+* Bulk loads [first, last) in O(n) when it is sorted; see
+* BinarySearchTree::assign(). The balances are set as the tree is built.
+*/
+template<class Key, class Value, class Compare, class NodeAlloc, class NodeType>
+template<typename ForwardIt>
+AVLTree<Key, Value, Compare, NodeAlloc, NodeType>::AVLTree(ForwardIt first, ForwardIt last, const Compare& comp) :
+    BinarySearchTree<Key, Value, Compare, NodeAlloc, NodeType>(comp)
+{
+    this->assign(first, last);
+}
+
+template<class Key, class Value, class Compare, class NodeAlloc, class NodeType>
+void AVLTree<Key, Value, Compare, NodeAlloc, NodeType>::setBuiltBalance(NodeType* node, int balance, size_t, size_t)
+{
+    node->setBalance(balance);
+}
+
+template<class Key, class Value, class Compare, class NodeAlloc, class NodeType>
+void AVLTree<Key, Value, Compare, NodeAlloc, NodeType>::rotateRight(NodeType* axis)
 {
-	AVLNode<Key, Value>* child = axis->getLeft();
-	AVLNode<Key, Value>* gparent = axis->getParent();
+	NodeType* child = axis->getLeft();
+	NodeType* gparent = axis->getParent();
 	if (child != NULL)
 	{
 		child->setParent(gparent);
@@ -209,7 +520,7 @@ void AVLTree<Key, Value>::rotateRight(AVLNode<Key, Value>* axis)
 	}
 	else
 	{
-		this->root_ = static_cast<Node<Key, Value>*>(child);
+		this->root_ = child;
 	}
 	if (child != NULL) 
 	{
@@ -221,13 +532,15 @@ void AVLTree<Key, Value>::rotateRight(AVLNode<Key, Value>* axis)
 		child->setRight(axis); 
 	}
 	axis->setParent(child);
+	this->refreshNode(axis);
+	if (child != NULL) this->refreshNode(child);
 }
 
-template<class Key, class Value>
-void AVLTree<Key, Value>::rotateLeft(AVLNode<Key, Value>* axis)
+template<class Key, class Value, class Compare, class NodeAlloc, class NodeType>
+void AVLTree<Key, Value, Compare, NodeAlloc, NodeType>::rotateLeft(NodeType* axis)
 {
-	AVLNode<Key, Value>* child = axis->getRight();
-	AVLNode<Key, Value>* gparent = axis->getParent();
+	NodeType* child = axis->getRight();
+	NodeType* gparent = axis->getParent();
 
 	if (child!= NULL)
 	{
@@ -247,7 +560,7 @@ void AVLTree<Key, Value>::rotateLeft(AVLNode<Key, Value>* axis)
 	}
 	else 
 	{
-		this->root_ = static_cast<Node<Key, Value>*>(child);
+		this->root_ = child;
 	}
 	axis->setRight(child->getLeft());
 	if (child->getLeft() != NULL)
@@ -256,87 +569,72 @@ void AVLTree<Key, Value>::rotateLeft(AVLNode<Key, Value>* axis)
 	}
 	child->setLeft(axis); 
 	axis->setParent(child);
+	this->refreshNode(axis);
+	this->refreshNode(child);
 }
 
 /*
- * Recall: If key is already in the tree, you should 
- * overwrite the current value with the updated value.
+ * An AVL tree keeps its own balance, so a rebalancing factor would never
+ * be checked; only 0, which is off, is accepted.
  */
-template<class Key, class Value>
-void AVLTree<Key, Value>::insert (const std::pair<const Key, Value> &new_item)
+template<class Key, class Value, class Compare, class NodeAlloc, class NodeType>
+void AVLTree<Key, Value, Compare, NodeAlloc, NodeType>::setAutoRebalance(double factor)
 {
-    // TODO
-    if (static_cast<AVLNode<Key, Value>*>(this->root_) == NULL)
+	if (factor != 0)
+	{
+		throw std::logic_error("setAutoRebalance: an AVLTree keeps its own balance");
+	}
+}
+
+/*
+ * Insertion itself is shared with BinarySearchTree (insert, emplace,
+ * try_emplace, insert_or_assign); this restores the balances after a
+ * new leaf has been linked in.
+ */
+template<class Key, class Value, class Compare, class NodeAlloc, class NodeType>
+void AVLTree<Key, Value, Compare, NodeAlloc, NodeType>::balanceAfterInsert(NodeType* leaf)
+{
+	NodeType* parent = leaf->getParent();
+	if (parent == NULL) // leaf is the new root
 	{
-		AVLNode<Key, Value>* insertroot = new AVLNode<Key, Value>(new_item.first, new_item.second, NULL);
-		this->root_ = static_cast<Node<Key, Value>*>(insertroot);
 		return;
 	}
-  AVLNode<Key, Value>* current = static_cast<AVLNode<Key, Value>*>(this->root_);
-  AVLNode<Key, Value>* currentcopy = static_cast<AVLNode<Key, Value>*>(this->root_);
-  bool insertedAlready = 0;
-
-  while (current != NULL)
-  {
-      if (current->getKey() > new_item.first)
-      {
-					currentcopy = current;
-					current = current->getLeft();
-      }
-      else if (current->getKey() < new_item.first)
-      {
-					currentcopy = current;
-          current = current->getRight();
-      }
-      else // (current->getKey == (&new_item)->getKey)
-      {
-          current->setValue(new_item.second);
-					insertedAlready = 1;
-					break;
-      }
-  }
-	if (!insertedAlready) // create a new leaf node with currentcopy as the parent 
-	{
-		AVLNode<Key, Value>* insertleaf = new AVLNode<Key, Value>(new_item.first, new_item.second, currentcopy);
-		if (insertleaf->getKey() > currentcopy->getKey()) // insert right leaf
-		{
-			currentcopy->setRight(insertleaf);
-			if (currentcopy->getBalance() == 0) // parent had no children 
-			{
-				currentcopy->updateBalance(1);
-				insertFix(currentcopy, currentcopy->getRight()); // sending parent and node to insertFix
-			}
-			else if (currentcopy->getBalance() == -1) // parent already has a left child
-			{
-				currentcopy->updateBalance(1); // setting parent balance to 0 since it now has a child on each side 
-			}
+	if (parent->getRight() == leaf) // inserted right leaf
+	{
+		if (parent->getBalance() == 0) // parent had no children 
+		{
+			parent->updateBalance(1);
+			insertFix(parent, leaf); // sending parent and node to insertFix
 		}
-		else // insert left leaf
+		else if (parent->getBalance() == -1) // parent already has a left child
 		{
-			currentcopy->setLeft(insertleaf);
-			if (currentcopy->getBalance() == 0) // parent has no children 
-			{
-				currentcopy->updateBalance(-1);
-				insertFix(currentcopy, currentcopy->getLeft()); // sending parent and node to insertFix
-			}
-			else if (currentcopy->getBalance() == 1) // parent already has a right child
-			{
-				currentcopy->updateBalance(-1);
-			}	
+			parent->updateBalance(1); // setting parent balance to 0 since it now has a child on each side 
+		}
+	}
+	else // inserted left leaf
+	{
+		if (parent->getBalance() == 0) // parent has no children 
+		{
+			parent->updateBalance(-1);
+			insertFix(parent, leaf); // sending parent and node to insertFix
 		}
+		else if (parent->getBalance() == 1) // parent already has a right child
+		{
+			parent->updateBalance(-1);
+		}	
 	}
 }
 //after you balance the granparent with rotating you have to 
 // see if you affected balance up higher 
 
-template<class Key, class Value>
-void AVLTree<Key, Value>::insertFix(AVLNode<Key, Value>* parent, AVLNode<Key, Value>* child)
+template<class Key, class Value, class Compare, class NodeAlloc, class NodeType>
+void AVLTree<Key, Value, Compare, NodeAlloc, NodeType>::insertFix(NodeType* parent, NodeType* child)
 {
 	if (parent == NULL)
 	{
 		return;
 	}
-	AVLNode<Key, Value>* gparent = parent->getParent();
+	NodeType* gparent = parent->getParent();
 	if (gparent == NULL)
 	{
 		return; 
@@ -449,11 +747,11 @@ void AVLTree<Key, Value>::insertFix(AVLNode<Key, Value>* parent, AVLNode<Key, Va
  * Recall: The writeup specifies that if a node has 2 children you
  * should swap with the predecessor and then remove.
  */
-template<class Key, class Value>
-void AVLTree<Key, Value>:: remove(const Key& key)
+template<class Key, class Value, class Compare, class NodeAlloc, class NodeType>
+void AVLTree<Key, Value, Compare, NodeAlloc, NodeType>:: remove(const Key& key)
 {
     // TODO
-		AVLNode<Key, Value>* nodeToRemove = static_cast<AVLNode<Key, Value>*>(BinarySearchTree<Key, Value>::internalFind(key));
+		NodeType* nodeToRemove = this->internalFind(key);
 		if (nodeToRemove == NULL) // node not in tree 
 		{
 			return;
@@ -461,13 +759,12 @@ void AVLTree<Key, Value>:: remove(const Key& key)
     // 2 children
 		if (nodeToRemove->getLeft() != NULL && nodeToRemove->getRight() != NULL)
 		{    
-			//Node<Key, Value>* bstpredec = BinarySearchTree<Key, Value>::predecessor(nodeToRemove); 
-			//AVLNode<Key, Value>* predec = bstpredec 
-			AVLNode<Key, Value>* predec = avlpredecessor(nodeToRemove); 
+			NodeType* predec = this->predecessor(nodeToRemove); 
 			nodeSwap(nodeToRemove, predec); // this will make predecessor the root if nodeToRemove was the root
 		}
+		this->detachBookkeeping(nodeToRemove);
 		// NEW
-		AVLNode<Key, Value>* p = nodeToRemove->getParent();
+		NodeType* p = nodeToRemove->getParent();
 		int8_t diff = 0; 
 		if (p != NULL)
 		{
@@ -484,7 +781,7 @@ void AVLTree<Key, Value>:: remove(const Key& key)
 		// no children
 		if (nodeToRemove->getLeft() == NULL && nodeToRemove->getRight() == NULL)
 		{
-			if (nodeToRemove == static_cast<AVLNode<Key, Value>*>(this->root_)) // no children, and it's the root - must be the only node in tree 
+			if (nodeToRemove == this->root_) // no children, and it's the root - must be the only node in tree 
 			{
 			    this->clear();
 					return;
@@ -497,35 +794,36 @@ void AVLTree<Key, Value>:: remove(const Key& key)
 			{
 				(nodeToRemove->getParent())->setRight(NULL);	
 			}
-			delete nodeToRemove;
+			this->alloc_.destroy(nodeToRemove);
 			nodeToRemove = NULL; 
 		}
 		// 1 child (left)
 		else if (nodeToRemove->getLeft() != NULL && nodeToRemove->getRight() == NULL)
 		{
-			BinarySearchTree<Key, Value>::promote(nodeToRemove->getLeft());
-			delete nodeToRemove;
+			this->promote(nodeToRemove->getLeft());
+			this->alloc_.destroy(nodeToRemove);
 			nodeToRemove = NULL;
 		}
 		// 1 child (right)
 		else if (nodeToRemove->getLeft() == NULL && nodeToRemove->getRight() != NULL)
 		{
-			BinarySearchTree<Key, Value>::promote(nodeToRemove->getRight());
-			delete nodeToRemove;
+			this->promote(nodeToRemove->getRight());
+			this->alloc_.destroy(nodeToRemove);
 			nodeToRemove = NULL;
 		}
+		this->refreshPath(p); // before removeFix, whose rotations read the children
 		//NEW 
 		removeFix(p, diff);
 }
 
-template<class Key, class Value>
-void AVLTree<Key, Value>::removeFix(AVLNode<Key, Value>* n, int8_t diff)
+template<class Key, class Value, class Compare, class NodeAlloc, class NodeType>
+void AVLTree<Key, Value, Compare, NodeAlloc, NodeType>::removeFix(NodeType* n, int8_t diff)
 {
 	if (n == NULL) // v is the root 
 	{
 		return;
 	}
-	AVLNode<Key, Value>* p = n->getParent();
+	NodeType* p = n->getParent();
 	int8_t ndiff = 0;
 	if (p != NULL)
 	{
@@ -543,7 +841,7 @@ void AVLTree<Key, Value>::removeFix(AVLNode<Key, Value>* n, int8_t diff)
 	{
 		if (n->getBalance() + diff == -2) // n's balance is already -1
 		{
-			AVLNode<Key, Value>* c = n->getLeft(); 
+			NodeType* c = n->getLeft(); 
 			// now check whether it's zigzig or zigzag, on the left side of p
 			if (c->getBalance() == -1) // zigzig
 			{
@@ -560,7 +858,7 @@ void AVLTree<Key, Value>::removeFix(AVLNode<Key, Value>* n, int8_t diff)
 			}
 			else if (c->getBalance() == 1) // zigzag
 			{
-				AVLNode<Key, Value>* g = c->getRight();
+				NodeType* g = c->getRight();
 				rotateLeft(c);
 				rotateRight(n);
 				if (g->getBalance() == 1)
@@ -600,7 +898,7 @@ void AVLTree<Key, Value>::removeFix(AVLNode<Key, Value>* n, int8_t diff)
 	{
 		if (n->getBalance() + diff == 2) // n's balance was already 1
 		{
-			AVLNode<Key, Value>* c = n->getRight();
+			NodeType* c = n->getRight();
 			if (c->getBalance() == 1) // zigzig
 			{
 				rotateLeft(n); 
@@ -616,7 +914,7 @@ void AVLTree<Key, Value>::removeFix(AVLNode<Key, Value>* n, int8_t diff)
 			}
 			else if (c->getBalance() == -1) // zigzag
 			{
-				AVLNode<Key, Value>* g = c->getLeft();
+				NodeType* g = c->getLeft();
 				rotateRight(c);
 				rotateLeft(n);
 				if (g->getBalance() == -1)
@@ -657,14 +955,651 @@ void AVLTree<Key, Value>::removeFix(AVLNode<Key, Value>* n, int8_t diff)
 }
 
 
-template<class Key, class Value>
-void AVLTree<Key, Value>::nodeSwap( AVLNode<Key,Value>* n1, AVLNode<Key,Value>* n2)
+/**
+* Leaves the keys less than key in this tree and moves the rest into
+* right, replacing its contents. The tree is cut along the search path
+* for key and the pieces on each side are joined back together, largest
+* last, with no node allocated or copied, in O(log n). Keeping size()
+* exact then needs the size of one piece: O(1) from the root's count
+* when NodeType counts its subtree (CountedAVLNode), otherwise a walk of
+* the smaller piece, so that splitting a tree in half costs O(n). Trees
+* meant to be split at large should be CountedAVLTrees.
+*/
+template<class Key, class Value, class Compare, class NodeAlloc, class NodeType>
+void AVLTree<Key, Value, Compare, NodeAlloc, NodeType>::split(const Key& key, AVLTree& right)
+{
+	static_assert(std::is_empty<NodeAlloc>::value, "split() moves nodes between trees, so NodeAlloc must be stateless");
+	if (&right == this)
+	{
+		return;
+	}
+	right.clear();
+	NodeType* oldMin = this->leftmost_;
+	NodeType* oldMax = this->rightmost_;
+	size_t oldSize = this->size_;
+	NodeType* low;
+	NodeType* high;
+	int lowHeight;
+	int highHeight;
+	splitSubtree(this->root_, avlHeight(this->root_), key, low, lowHeight, high, highHeight);
+
+	this->root_ = low;
+	right.root_ = high;
+	this->leftmost_ = low != NULL ? oldMin : NULL;
+	this->rightmost_ = low;
+	while (this->rightmost_ != NULL && this->rightmost_->getRight() != NULL)
+	{
+		this->rightmost_ = this->rightmost_->getRight();
+	}
+	right.rightmost_ = high != NULL ? oldMax : NULL;
+	right.leftmost_ = high;
+	while (right.leftmost_ != NULL && right.leftmost_->getLeft() != NULL)
+	{
+		right.leftmost_ = right.leftmost_->getLeft();
+	}
+	bool lowSmaller;
+	size_t smaller = this->countSmaller(low, high, lowSmaller);
+	this->size_ = lowSmaller ? smaller : oldSize - smaller;
+	right.size_ = oldSize - this->size_;
+}
+
+/**
+* Appends every item of right, whose keys must all be greater than the
+* keys here, and leaves right empty. Runs in O(log n): right's smallest
+* node is unlinked and becomes the pivot joining the two trees. Throws
+* std::invalid_argument, changing nothing, if the keys interleave.
+*/
+template<class Key, class Value, class Compare, class NodeAlloc, class NodeType>
+void AVLTree<Key, Value, Compare, NodeAlloc, NodeType>::join(AVLTree& right)
+{
+	static_assert(std::is_empty<NodeAlloc>::value, "join() moves nodes between trees, so NodeAlloc must be stateless");
+	if (&right == this || right.root_ == NULL)
+	{
+		return;
+	}
+	if (this->root_ != NULL && this->compareKeys(this->rightmost_->getKey(), right.leftmost_->getKey()) >= 0)
+	{
+		throw std::invalid_argument("join: keys of right are not all greater");
+	}
+	size_t total = this->size_ + right.size_;
+	NodeType* oldMin = this->root_ != NULL ? this->leftmost_ : right.leftmost_;
+	NodeType* oldMax = right.rightmost_;
+
+	// unlink right's smallest node; it has no left child
+	NodeType* pivot = right.leftmost_;
+	right.detachBookkeeping(pivot);
+	NodeType* parent = pivot->getParent();
+	NodeType* child = pivot->getRight();
+	if (parent == NULL)
+	{
+		right.root_ = child;
+	}
+	else
+	{
+		parent->setLeft(child);
+	}
+	if (child != NULL)
+	{
+		child->setParent(parent);
+	}
+	right.refreshPath(parent);
+	right.removeFix(parent, 1);
+
+	int height;
+	this->root_ = joinWithPivot(this->root_, avlHeight(this->root_), pivot, right.root_, avlHeight(right.root_), height);
+	this->leftmost_ = oldMin;
+	this->rightmost_ = oldMax;
+	this->size_ = total;
+	right.root_ = NULL;
+	right.leftmost_ = NULL;
+	right.rightmost_ = NULL;
+	right.size_ = 0;
+}
+
+/**
+* Removes the items with keys from lo through hi; none if hi is below lo.
+* Runs in O(log n) plus the time to free them.
+*/
+template<class Key, class Value, class Compare, class NodeAlloc, class NodeType>
+size_t AVLTree<Key, Value, Compare, NodeAlloc, NodeType>::removeRange(const Key& lo, const Key& hi)
+{
+	if (this->compareKeys(hi, lo) < 0)
+	{
+		return 0;
+	}
+	return eraseNodes(this->ceilingNode(lo, true), this->ceilingNode(hi, false));
+}
+
+/**
+* Removes the items from first up to but not including last, which must
+* be an iterator of this tree at or after first. Iterators to other
+* items stay valid.
+*/
+template<class Key, class Value, class Compare, class NodeAlloc, class NodeType>
+size_t AVLTree<Key, Value, Compare, NodeAlloc, NodeType>::erase(iterator first, iterator last)
+{
+	return eraseNodes(this->nodeAt(first), this->nodeAt(last));
+}
+
+/**
+* Cuts the nodes from first up to last (NULL for the end) out of the
+* tree by splitting before each, frees them, and joins what is left.
+* The nodes outside the range are relinked but never moved or copied.
+*/
+template<class Key, class Value, class Compare, class NodeAlloc, class NodeType>
+size_t AVLTree<Key, Value, Compare, NodeAlloc, NodeType>::eraseNodes(NodeType* first, NodeType* last)
+{
+	if (first == NULL || first == last)
+	{
+		return 0;
+	}
+	NodeType* oldMin = this->leftmost_;
+	NodeType* oldMax = this->rightmost_;
+
+	NodeType* low;
+	NodeType* rest;
+	NodeType* high = NULL;
+	int lowHeight;
+	int restHeight;
+	int highHeight = 0;
+	splitSubtree(this->root_, avlHeight(this->root_), first->getKey(), low, lowHeight, rest, restHeight);
+	NodeType* doomed = rest;
+	if (last != NULL)
+	{
+		int doomedHeight;
+		splitSubtree(rest, restHeight, last->getKey(), doomed, doomedHeight, high, highHeight);
+	}
+	size_t removed = this->postOrderTraveralClear(doomed);
+
+	int height;
+	this->root_ = joinSubtrees(low, lowHeight, high, highHeight, height);
+	if (this->root_ != NULL)
+	{
+		this->root_->setParent(NULL);
+	}
+	this->leftmost_ = low != NULL ? oldMin : last;
+	this->rightmost_ = high != NULL ? oldMax : NULL;
+	if (high == NULL && low != NULL)
+	{
+		for (this->rightmost_ = low; this->rightmost_->getRight() != NULL; this->rightmost_ = this->rightmost_->getRight())
+		{
+		}
+	}
+	this->size_ -= removed;
+	return removed;
+}
+
+/**
+* Splits the subtree at node, of the given height, into the nodes with
+* keys below key and the rest, returning both roots and heights. Each
+* level joins the half it keeps to the piece split from below, so the
+* joins cost O(log n) altogether. Given match, a node holding key is
+* left out of both halves and returned there instead.
+*/
+template<class Key, class Value, class Compare, class NodeAlloc, class NodeType>
+void AVLTree<Key, Value, Compare, NodeAlloc, NodeType>::splitSubtree(NodeType* node, int height, const Key& key,
+	NodeType*& low, int& lowHeight, NodeType*& high, int& highHeight, NodeType** match)
+{
+	if (node == NULL)
+	{
+		low = high = NULL;
+		lowHeight = highHeight = 0;
+		return;
+	}
+	NodeType* left = node->getLeft();
+	NodeType* right = node->getRight();
+	int leftHeight = childHeight(node, height, true);
+	int rightHeight = childHeight(node, height, false);
+	if (left != NULL) left->setParent(NULL);
+	if (right != NULL) right->setParent(NULL);
+
+	int order = this->compareKeys(node->getKey(), key);
+	if (order == 0 && match != NULL)
+	{
+		*match = node;
+		low = left;
+		lowHeight = leftHeight;
+		high = right;
+		highHeight = rightHeight;
+	}
+	else if (order < 0)
+	{
+		NodeType* rightLow;
+		int rightLowHeight;
+		splitSubtree(right, rightHeight, key, rightLow, rightLowHeight, high, highHeight, match);
+		low = joinWithPivot(left, leftHeight, node, rightLow, rightLowHeight, lowHeight);
+	}
+	else
+	{
+		NodeType* leftHigh;
+		int leftHighHeight;
+		splitSubtree(left, leftHeight, key, low, lowHeight, leftHigh, leftHighHeight, match);
+		high = joinWithPivot(leftHigh, leftHighHeight, node, right, rightHeight, highHeight);
+	}
+}
+
+/**
+* Joins the detached subtrees left and right, every key of left below
+* every key of right, with right's smallest node as the pivot.
+*/
+template<class Key, class Value, class Compare, class NodeAlloc, class NodeType>
+NodeType* AVLTree<Key, Value, Compare, NodeAlloc, NodeType>::joinSubtrees(NodeType* left, int leftHeight,
+	NodeType* right, int rightHeight, int& height)
+{
+	if (left == NULL || right == NULL)
+	{
+		height = left == NULL ? rightHeight : leftHeight;
+		return left == NULL ? right : left;
+	}
+	NodeType* pivot = detachMin(right, rightHeight);
+	return joinWithPivot(left, leftHeight, pivot, right, rightHeight, height);
+}
+
+/**
+* Unlinks and returns the smallest node of the detached subtree at root,
+* rebalancing the rest and updating root and height to match.
+*/
+template<class Key, class Value, class Compare, class NodeAlloc, class NodeType>
+NodeType* AVLTree<Key, Value, Compare, NodeAlloc, NodeType>::detachMin(NodeType*& root, int& height)
+{
+	NodeType* node = root;
+	while (node->getLeft() != NULL)
+	{
+		node = node->getLeft();
+	}
+	NodeType* parent = node->getParent();
+	NodeType* child = node->getRight();
+	if (child != NULL)
+	{
+		child->setParent(parent);
+	}
+	if (parent == NULL)
+	{
+		root = child;
+	}
+	else
+	{
+		parent->setLeft(child);
+		this->refreshPath(parent);
+		removeFix(parent, 1);
+		// rotations may have moved the top, but not out of parent's ancestry
+		for (root = parent; root->getParent() != NULL; root = root->getParent())
+		{
+		}
+	}
+	height = avlHeight(root);
+	node->setParent(NULL);
+	node->setRight(NULL);
+	return node;
+}
+
+/**
+* Makes root, the result of a set operation holding count nodes, the
+* whole tree and empties other, whose nodes it took.
+*/
+template<class Key, class Value, class Compare, class NodeAlloc, class NodeType>
+void AVLTree<Key, Value, Compare, NodeAlloc, NodeType>::adoptRoot(NodeType* root, size_t count, AVLTree& other)
+{
+	this->root_ = root;
+	this->leftmost_ = root;
+	this->rightmost_ = root;
+	if (root != NULL)
+	{
+		root->setParent(NULL);
+		while (this->leftmost_->getLeft() != NULL) this->leftmost_ = this->leftmost_->getLeft();
+		while (this->rightmost_->getRight() != NULL) this->rightmost_ = this->rightmost_->getRight();
+	}
+	this->size_ = count;
+	other.root_ = NULL;
+	other.leftmost_ = NULL;
+	other.rightmost_ = NULL;
+	other.size_ = 0;
+}
+
+template<class Key, class Value, class Compare, class NodeAlloc, class NodeType>
+void AVLTree<Key, Value, Compare, NodeAlloc, NodeType>::unionWith(AVLTree& other)
+{
+	SerialExecutor serial;
+	unionWith(other, serial);
+}
+
+template<class Key, class Value, class Compare, class NodeAlloc, class NodeType>
+void AVLTree<Key, Value, Compare, NodeAlloc, NodeType>::intersectWith(AVLTree& other)
+{
+	SerialExecutor serial;
+	intersectWith(other, serial);
+}
+
+template<class Key, class Value, class Compare, class NodeAlloc, class NodeType>
+void AVLTree<Key, Value, Compare, NodeAlloc, NodeType>::differenceWith(AVLTree& other)
+{
+	SerialExecutor serial;
+	differenceWith(other, serial);
+}
+
+/**
+* Adds every item of other whose key is not here. Runs in
+* O(m log(n/m + 1)) for trees of m <= n items, split across executor's
+* threads; NodeAlloc must then be safe to use from several threads, as
+* NewDeleteNodeAllocator is.
+*/
+template<class Key, class Value, class Compare, class NodeAlloc, class NodeType>
+template<typename Executor>
+void AVLTree<Key, Value, Compare, NodeAlloc, NodeType>::unionWith(AVLTree& other, Executor& executor)
+{
+	static_assert(std::is_empty<NodeAlloc>::value, "set operations move nodes between trees, so NodeAlloc must be stateless");
+	if (&other == this)
+	{
+		return;
+	}
+	int height;
+	size_t dropped = 0;
+	size_t total = this->size_ + other.size_;
+	NodeType* root = combine(UNION, this->root_, avlHeight(this->root_), other.root_, avlHeight(other.root_), height, dropped, executor);
+	adoptRoot(root, total - dropped, other);
+}
+
+/**
+* Keeps only the keys also in other; see unionWith(). Nodes dropped from
+* either tree are destroyed.
+*/
+template<class Key, class Value, class Compare, class NodeAlloc, class NodeType>
+template<typename Executor>
+void AVLTree<Key, Value, Compare, NodeAlloc, NodeType>::intersectWith(AVLTree& other, Executor& executor)
+{
+	static_assert(std::is_empty<NodeAlloc>::value, "set operations move nodes between trees, so NodeAlloc must be stateless");
+	if (&other == this)
+	{
+		return;
+	}
+	int height;
+	size_t dropped = 0;
+	size_t total = this->size_ + other.size_;
+	NodeType* root = combine(INTERSECTION, this->root_, avlHeight(this->root_), other.root_, avlHeight(other.root_), height, dropped, executor);
+	adoptRoot(root, total - dropped, other);
+}
+
+/**
+* Removes the keys that are in other; see unionWith(). Every node of
+* other is destroyed.
+*/
+template<class Key, class Value, class Compare, class NodeAlloc, class NodeType>
+template<typename Executor>
+void AVLTree<Key, Value, Compare, NodeAlloc, NodeType>::differenceWith(AVLTree& other, Executor& executor)
+{
+	static_assert(std::is_empty<NodeAlloc>::value, "set operations move nodes between trees, so NodeAlloc must be stateless");
+	if (&other == this)
+	{
+		this->clear();
+		return;
+	}
+	int height;
+	size_t dropped = 0;
+	size_t total = this->size_ + other.size_;
+	NodeType* root = combine(DIFFERENCE, this->root_, avlHeight(this->root_), other.root_, avlHeight(other.root_), height, dropped, executor);
+	adoptRoot(root, total - dropped, other);
+}
+
+/**
+* Applies op to the detached subtrees a and b and returns the root of the
+* result. b is split around a's root, op is applied to the two pairs of
+* halves, which share no nodes and can run on different threads, and
+* the results are joined around a's root when the result keeps it.
+* Each call links nodes through its own scratch tree, whose root the
+* rotations may overwrite, so no state is shared between threads.
+* Adds the number of nodes destroyed to dropped, which tells the caller
+* the size of the result without a count of the subtrees kept whole.
+*/
+template<class Key, class Value, class Compare, class NodeAlloc, class NodeType>
+template<typename Executor>
+NodeType* AVLTree<Key, Value, Compare, NodeAlloc, NodeType>::combine(SetOperation op, NodeType* a, int aHeight,
+	NodeType* b, int bHeight, int& height, size_t& dropped, Executor& executor) const
+{
+	AVLTree scratch(this->comp_);
+	if (a == NULL || b == NULL)
+	{
+		NodeType* kept = op == UNION ? (a == NULL ? b : a) : (op == DIFFERENCE ? a : NULL);
+		if (kept != a) dropped += scratch.postOrderTraveralClear(a);
+		if (kept != b) dropped += scratch.postOrderTraveralClear(b);
+		height = kept == NULL ? 0 : (kept == a ? aHeight : bHeight);
+		return kept;
+	}
+
+	NodeType* aLeft = a->getLeft();
+	NodeType* aRight = a->getRight();
+	int aLeftHeight = childHeight(a, aHeight, true);
+	int aRightHeight = childHeight(a, aHeight, false);
+	if (aLeft != NULL) aLeft->setParent(NULL);
+	if (aRight != NULL) aRight->setParent(NULL);
+	NodeType* match = NULL;
+	NodeType* bLow;
+	NodeType* bHigh;
+	int bLowHeight;
+	int bHighHeight;
+	scratch.splitSubtree(b, bHeight, a->getKey(), bLow, bLowHeight, bHigh, bHighHeight, &match);
+
+	NodeType* low;
+	NodeType* high;
+	int lowHeight;
+	int highHeight;
+	// each side counts into its own variable, as the two may run at once
+	size_t lowDropped = 0;
+	size_t highDropped = 0;
+	auto lowSide = [&] { low = this->combine(op, aLeft, aLeftHeight, bLow, bLowHeight, lowHeight, lowDropped, executor); };
+	auto highSide = [&] { high = this->combine(op, aRight, aRightHeight, bHigh, bHighHeight, highHeight, highDropped, executor); };
+	if (aHeight >= PARALLEL_HEIGHT)
+	{
+		executor.runBoth(lowSide, highSide);
+	}
+	else
+	{
+		lowSide();
+		highSide();
+	}
+
+	dropped += lowDropped + highDropped;
+	if (match != NULL)
+	{
+		scratch.alloc_.destroy(match);
+		++dropped;
+	}
+	NodeType* result;
+	if (op == INTERSECTION ? match != NULL : (op == UNION || match == NULL))
+	{
+		result = scratch.joinWithPivot(low, lowHeight, a, high, highHeight, height);
+	}
+	else
+	{
+		scratch.alloc_.destroy(a);
+		++dropped;
+		result = scratch.joinSubtrees(low, lowHeight, high, highHeight, height);
+	}
+	scratch.root_ = NULL; // the nodes belong to the caller
+	return result;
+}
+
+/**
+* Joins the detached subtrees left and right, every key of left below
+* pivot's and every key of right above it, with pivot between them.
+* Returns the new root and its height. pivot hangs where the taller
+* side's spine reaches the other side's height, and the retrace up
+* from there is an insertion's, so the cost is the height difference.
+*/
+template<class Key, class Value, class Compare, class NodeAlloc, class NodeType>
+NodeType* AVLTree<Key, Value, Compare, NodeAlloc, NodeType>::joinWithPivot(NodeType* left, int leftHeight,
+	NodeType* pivot, NodeType* right, int rightHeight, int& height)
+{
+	pivot->setParent(NULL);
+	if (leftHeight <= rightHeight + 1 && rightHeight <= leftHeight + 1)
+	{
+		pivot->setLeft(left);
+		pivot->setRight(right);
+		if (left != NULL) left->setParent(pivot);
+		if (right != NULL) right->setParent(pivot);
+		pivot->setBalance(rightHeight - leftHeight);
+		this->refreshNode(pivot);
+		height = std::max(leftHeight, rightHeight) + 1;
+		return pivot;
+	}
+
+	bool leftTaller = leftHeight > rightHeight;
+	NodeType* top = leftTaller ? left : right;
+	int shortHeight = leftTaller ? rightHeight : leftHeight;
+	NodeType* parent = NULL;
+	NodeType* spine = top;
+	int spineHeight = leftTaller ? leftHeight : rightHeight;
+	while (spineHeight > shortHeight + 1)
+	{
+		parent = spine;
+		spineHeight = childHeight(spine, spineHeight, !leftTaller);
+		spine = leftTaller ? spine->getRight() : spine->getLeft();
+	}
+
+	// spine is one level taller than the short side or level with it
+	NodeType* shortSide = leftTaller ? right : left;
+	pivot->setLeft(leftTaller ? spine : shortSide);
+	pivot->setRight(leftTaller ? shortSide : spine);
+	if (spine != NULL) spine->setParent(pivot);
+	if (shortSide != NULL) shortSide->setParent(pivot);
+	pivot->setBalance(leftTaller ? shortHeight - spineHeight : spineHeight - shortHeight);
+	pivot->setParent(parent);
+	if (leftTaller)
+	{
+		parent->setRight(pivot);
+	}
+	else
+	{
+		parent->setLeft(pivot);
+	}
+	this->refreshPath(pivot); // before growFix, whose rotations read the children
+	bool grew = growFix(pivot);
+
+	// a rotation at the top leaves the old top one level down
+	height = (leftTaller ? leftHeight : rightHeight) + (grew ? 1 : 0);
+	return top->getParent() != NULL ? top->getParent() : top;
+}
+
+/**
+* Retraces after the subtree at node grew one level taller: the general
+* form of the insertion retrace, which also handles a grown child whose
+* balance is 0, as a join can leave. Returns true if the growth reaches
+* the top of the tree.
+*/
+template<class Key, class Value, class Compare, class NodeAlloc, class NodeType>
+bool AVLTree<Key, Value, Compare, NodeAlloc, NodeType>::growFix(NodeType* node)
+{
+	for (;;)
+	{
+		NodeType* parent = node->getParent();
+		if (parent == NULL)
+		{
+			return true;
+		}
+		int side = parent->getLeft() == node ? -1 : 1;
+		parent->updateBalance(side);
+		if (parent->getBalance() == 0)
+		{
+			return false;
+		}
+		if (parent->getBalance() == side)
+		{
+			node = parent; // parent grew too
+			continue;
+		}
+		// parent is now 2 levels heavier on node's side
+		if (node->getBalance() == side) // zigzig
+		{
+			side < 0 ? rotateRight(parent) : rotateLeft(parent);
+			parent->setBalance(0);
+			node->setBalance(0);
+			return false;
+		}
+		if (node->getBalance() == 0) // only after a join; the height still grows
+		{
+			side < 0 ? rotateRight(parent) : rotateLeft(parent);
+			parent->setBalance(side);
+			node->setBalance(-side);
+			continue;
+		}
+		// zigzag
+		NodeType* grandchild = side < 0 ? node->getRight() : node->getLeft();
+		if (side < 0)
+		{
+			rotateLeft(node);
+			rotateRight(parent);
+		}
+		else
+		{
+			rotateRight(node);
+			rotateLeft(parent);
+		}
+		int8_t g = grandchild->getBalance();
+		parent->setBalance(g == side ? -side : 0);
+		node->setBalance(g == -side ? side : 0);
+		grandchild->setBalance(0);
+		return false;
+	}
+}
+
+/**
+* Height of an AVL subtree in O(log n): the balances name the taller
+* child at every level.
+*/
+template<class Key, class Value, class Compare, class NodeAlloc, class NodeType>
+int AVLTree<Key, Value, Compare, NodeAlloc, NodeType>::avlHeight(NodeType* root)
+{
+	int height = 0;
+	for (; root != NULL; root = root->getBalance() < 0 ? root->getLeft() : root->getRight())
+	{
+		++height;
+	}
+	return height;
+}
+
+/**
+* Height of node's left (or right) child, given node's own height.
+*/
+template<class Key, class Value, class Compare, class NodeAlloc, class NodeType>
+int AVLTree<Key, Value, Compare, NodeAlloc, NodeType>::childHeight(NodeType* node, int height, bool left)
+{
+	int balance = node->getBalance();
+	return height - 1 - ((left ? balance > 0 : balance < 0) ? 1 : 0);
+}
+
+template<class Key, class Value, class Compare, class NodeAlloc, class NodeType>
+void AVLTree<Key, Value, Compare, NodeAlloc, NodeType>::nodeSwap( NodeType* n1, NodeType* n2)
 {
-    BinarySearchTree<Key, Value>::nodeSwap(n1, n2);
+    BinarySearchTree<Key, Value, Compare, NodeAlloc, NodeType>::nodeSwap(n1, n2);
     int8_t tempB = n1->getBalance();
     n1->setBalance(n2->getBalance());
     n2->setBalance(tempB);
 }
 
 
+/**
+* An AVLTree of IndexAVLNodes: 32-bit links into a per-tree arena of
+* chunks, with the balance packed into spare index bits.
+*/
+template <class Key, class Value, class Compare = std::less<Key> >
+using IndexedAVLTree = AVLTree<Key, Value, Compare, ArenaNodeAllocator, IndexAVLNode<Key, Value> >;
+
+/**
+* An AVLTree of SplitAVLNodes: searches touch only keys, links and
+* balances, and the items are pooled separately.
+*/
+template <class Key, class Value, class Compare = std::less<Key> >
+using SplitAVLTree = AVLTree<Key, Value, Compare, SplitNodeAllocator<>, SplitAVLNode<Key, Value> >;
+
+/**
+* An AVLTree of CountedAVLNodes, for select(), rank() and countRange().
+*/
+template <class Key, class Value, class Compare = std::less<Key> >
+using CountedAVLTree = AVLTree<Key, Value, Compare, NewDeleteNodeAllocator, CountedAVLNode<Key, Value> >;
+
+/**
+* An AVLTree of AggregateAVLNodes, for rangeAggregate() under Monoid.
+*/
+template <class Key, class Value, class Monoid, class Compare = std::less<Key> >
+using AggregateAVLTree = AVLTree<Key, Value, Compare, NewDeleteNodeAllocator, AggregateAVLNode<Key, Value, Monoid> >;
+
 #endif
@@ -0,0 +1,716 @@
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <random>
+#include <algorithm>
+#include <iterator>
+#include "bst.h"
+#include "avlbst.h"
+#include "pathavl.h"
+#include "small_tree.h"
+#include "interval_tree.h"
+#include "redblack.h"
+#include "splay.h"
+#include "thread_pool.h"
+#include "btree.h"
+
+using namespace std;
+
+// Benchmarks for the search trees. Each case prints one line:
+//   <case> <tree> <milliseconds>
+// Usage: bst-bench [number of keys]
+
+typedef chrono::steady_clock Clock;
+
+static double msSince(Clock::time_point start)
+{
+    return chrono::duration<double, milli>(Clock::now() - start).count();
+}
+
+static void report(const string& name, const string& tree, double ms)
+{
+    cout << left << setw(12) << name << setw(24) << tree
+         << right << fixed << setprecision(1) << setw(10) << ms << " ms" << endl;
+}
+
+// Keeps the optimizer from discarding the work being timed.
+static volatile long long sink;
+
+// A value large enough that inline storage spreads keys across cache lines.
+struct Record
+{
+    Record(int v) : id(v) { }
+    int id;
+    char payload[196];
+};
+
+// print() is virtual, so every value type needs to be printable
+static ostream& operator<<(ostream& out, const Record& r)
+{
+    return out << r.id;
+}
+
+static long long weight(int v)
+{
+    return v;
+}
+
+static long long weight(const Record& r)
+{
+    return r.id;
+}
+
+template<typename Tree, typename Value>
+void benchLookup(const string& tree, const vector<int>& keys, const vector<int>& probes)
+{
+    Tree t;
+    Clock::time_point start = Clock::now();
+    for(size_t i = 0; i < keys.size(); ++i) {
+        t.insert(make_pair(keys[i], Value(keys[i])));
+    }
+    report("insert", tree, msSince(start));
+
+    long long found = 0;
+    start = Clock::now();
+    for(size_t i = 0; i < probes.size(); ++i) {
+        if(t.find(probes[i]) != t.end()) {
+            ++found;
+        }
+    }
+    report("find", tree, msSince(start));
+
+    long long sum = 0;
+    start = Clock::now();
+    for(int pass = 0; pass < 10; ++pass) {
+        for(typename Tree::iterator it = t.begin(); it != t.end(); ++it) {
+            sum += weight(it->second);
+        }
+    }
+    report("iterate x10", tree, msSince(start));
+
+    start = Clock::now();
+    for(size_t i = 0; i < keys.size(); i += 2) {
+        t.remove(keys[i]);
+    }
+    report("remove", tree, msSince(start));
+    sink = found + sum;
+}
+
+// A loaded tree under a stream of operations, writePercent of them an
+// insert or a remove of a random key and the rest finds.
+template<typename Tree>
+void benchMix(const string& tree, const vector<int>& keys, const vector<int>& probes, int writePercent)
+{
+    Tree t;
+    for(size_t i = 0; i < keys.size(); ++i) {
+        t.insert(make_pair(keys[i], keys[i]));
+    }
+    long long found = 0;
+    Clock::time_point start = Clock::now();
+    for(size_t i = 0; i < probes.size(); ++i) {
+        int roll = static_cast<int>(i * 37 % 100);
+        if(roll >= writePercent) {
+            found += t.find(probes[i]) != t.end();
+        }
+        else if(roll % 2 == 0) {
+            t.insert(make_pair(probes[i], probes[i]));
+        }
+        else {
+            t.remove(probes[i]);
+        }
+    }
+    report(to_string(writePercent) + "% writes", tree, msSince(start));
+    sink = found + t.size();
+}
+
+// A plain BinarySearchTree fed sorted keys, which leaves a path, then
+// probed: as is, after one rebalance(), and with setAutoRebalance(2) on.
+static void benchDegenerate(int n)
+{
+    mt19937 rng(7);
+    vector<int> probes(n);
+    for(int i = 0; i < n; ++i) {
+        probes[i] = static_cast<int>(rng() % n);
+    }
+    for(int mode = 0; mode < 3; ++mode) {
+        BinarySearchTree<int,int> t;
+        if(mode == 2) {
+            t.setAutoRebalance(2);
+        }
+        Clock::time_point start = Clock::now();
+        for(int i = 0; i < n; ++i) {
+            t.insert(make_pair(i, i));
+        }
+        if(mode == 1) {
+            t.rebalance();
+        }
+        long long found = 0;
+        for(int i = 0; i < n; ++i) {
+            found += t.find(probes[i]) != t.end();
+        }
+        const char* names[] = { "as is", "rebalance()", "auto x2" };
+        report("load+find", string("BST ") + names[mode], msSince(start));
+        sink = found;
+    }
+}
+
+// Finds replaying a trace of keys, on a tree loaded beforehand.
+template<typename Tree>
+void benchTrace(const string& name, const string& tree, const vector<int>& keys, const vector<int>& trace)
+{
+    Tree t;
+    for(size_t i = 0; i < keys.size(); ++i) {
+        t.insert(make_pair(keys[i], keys[i]));
+    }
+    long long found = 0;
+    Clock::time_point start = Clock::now();
+    for(size_t i = 0; i < trace.size(); ++i) {
+        found += t.find(trace[i]) != t.end();
+    }
+    report(name, tree, msSince(start));
+    sink = found;
+}
+
+// count lookups, the i-th most popular key drawn with probability
+// proportional to 1/(i+1)^s. Popularity is shuffled apart from the
+// insertion order, which would otherwise leave the hot keys near the top
+// of an AVLTree.
+static vector<int> zipfTrace(const vector<int>& keys, size_t count, double s, mt19937& rng)
+{
+    vector<int> byRank(keys);
+    shuffle(byRank.begin(), byRank.end(), rng);
+    vector<double> cdf(keys.size());
+    double total = 0;
+    for(size_t i = 0; i < keys.size(); ++i) {
+        total += 1.0 / pow(i + 1.0, s);
+        cdf[i] = total;
+    }
+    uniform_real_distribution<double> uniform(0, total);
+    vector<int> trace(count);
+    for(size_t i = 0; i < count; ++i) {
+        size_t rank = lower_bound(cdf.begin(), cdf.end(), uniform(rng)) - cdf.begin();
+        trace[i] = byRank[min(rank, keys.size() - 1)];
+    }
+    return trace;
+}
+
+// The first half of a trace profiles a HitCountTree, optimizeForAccess()
+// reshapes it, and the second half is replayed; AVLTree for comparison.
+static void benchOptimized(const vector<int>& keys, const vector<int>& trace)
+{
+    size_t half = trace.size() / 2;
+    HitCountTree<int,int> t;
+    AVLTree<int,int> avl;
+    for(size_t i = 0; i < keys.size(); ++i) {
+        t.insert(make_pair(keys[i], keys[i]));
+        avl.insert(make_pair(keys[i], keys[i]));
+    }
+    long long found = 0;
+    Clock::time_point start = Clock::now();
+    for(size_t i = 0; i < half; ++i) {
+        found += t.find(trace[i]) != t.end();
+    }
+    report("profile", "HitCountTree", msSince(start));
+    start = Clock::now();
+    t.optimizeForAccess();
+    report("optimize", "HitCountTree", msSince(start));
+    start = Clock::now();
+    for(size_t i = half; i < trace.size(); ++i) {
+        found += t.find(trace[i]) != t.end();
+    }
+    report("replay", "HitCountTree", msSince(start));
+    start = Clock::now();
+    for(size_t i = half; i < trace.size(); ++i) {
+        found += avl.find(trace[i]) != avl.end();
+    }
+    report("replay", "AVLTree", msSince(start));
+    sink = found;
+}
+
+// Lookups and iteration on a tree scattered by churn, then after compact().
+template<typename Tree>
+void benchCompact(const string& tree, const vector<int>& keys, const vector<int>& probes)
+{
+    Tree t;
+    mt19937 rng(99);
+    for(size_t i = 0; i < keys.size(); ++i) {
+        t.insert(make_pair(keys[i], keys[i]));
+    }
+    for(size_t round = 0; round < 4; ++round) {
+        for(size_t i = 0; i < keys.size(); ++i) {
+            int k = keys[rng() % keys.size()];
+            t.remove(k);
+            t.insert(make_pair(k, k));
+        }
+    }
+
+    const char* names[] = { "churned", "in-order", "vEB" };
+    for(int phase = 0; phase < 3; ++phase) {
+        if(phase == 1) t.compact(IN_ORDER);
+        if(phase == 2) t.compact(VAN_EMDE_BOAS);
+
+        long long found = 0;
+        Clock::time_point start = Clock::now();
+        for(size_t i = 0; i < probes.size(); ++i) {
+            if(t.find(probes[i]) != t.end()) {
+                ++found;
+            }
+        }
+        report("find", tree + " " + names[phase], msSince(start));
+
+        long long sum = 0;
+        start = Clock::now();
+        for(int pass = 0; pass < 10; ++pass) {
+            for(typename Tree::iterator it = t.begin(); it != t.end(); ++it) {
+                sum += it->second;
+            }
+        }
+        report("iterate x10", tree + " " + names[phase], msSince(start));
+        sink = found + sum;
+    }
+}
+
+// Loading already sorted items: one insert per item, hinted inserts at
+// end() and assign().
+template<typename Tree>
+void benchSortedLoad(const string& tree, int n)
+{
+    vector<pair<int,int> > items(n);
+    for(int i = 0; i < n; ++i) {
+        items[i] = make_pair(i * 2, i);
+    }
+
+    Clock::time_point start = Clock::now();
+    {
+        Tree t;
+        for(size_t i = 0; i < items.size(); ++i) {
+            t.insert(items[i]);
+        }
+        report("insert", tree, msSince(start));
+        sink = t.size();
+    }
+
+    start = Clock::now();
+    {
+        Tree t;
+        for(size_t i = 0; i < items.size(); ++i) {
+            t.insert(t.end(), items[i]);
+        }
+        report("insert hint", tree, msSince(start));
+        sink = t.size();
+    }
+
+    start = Clock::now();
+    {
+        Tree t(items.begin(), items.end());
+        report("assign", tree, msSince(start));
+        sink = t.size();
+    }
+}
+
+// Unsorted batches into a populated tree: one insert per item versus
+// insertBatch().
+template<typename Tree>
+void benchBatch(const string& tree, const vector<int>& keys, int batchSize)
+{
+    mt19937 rng(21);
+    vector<vector<pair<int,int> > > batches(10, vector<pair<int,int> >(batchSize));
+    for(size_t b = 0; b < batches.size(); ++b) {
+        for(int i = 0; i < batchSize; ++i) {
+            int k = static_cast<int>(rng() % (4u * keys.size()));
+            batches[b][i] = make_pair(k, k);
+        }
+    }
+
+    // both trees are built before either is timed, so neither starts on a
+    // heap scrambled by the other's destruction
+    Tree trees[2];
+    for(size_t i = 0; i < keys.size(); ++i) {
+        trees[0].insert(make_pair(keys[i], keys[i]));
+        trees[1].insert(make_pair(keys[i], keys[i]));
+    }
+    for(int batched = 0; batched < 2; ++batched) {
+        Tree& t = trees[batched];
+        Clock::time_point start = Clock::now();
+        for(size_t b = 0; b < batches.size(); ++b) {
+            if(batched) {
+                t.insertBatch(batches[b].begin(), batches[b].end());
+            }
+            else {
+                for(size_t i = 0; i < batches[b].size(); ++i) {
+                    t.insert(batches[b][i]);
+                }
+            }
+        }
+        report(batched ? "insertBatch" : "insert", tree + " x" + to_string(batchSize), msSince(start));
+        sink = t.size();
+    }
+}
+
+// Percentile lookups: walking from begin() versus select() on a tree
+// whose nodes count their subtrees.
+template<typename Tree>
+void benchSelect(const string& tree, const vector<int>& keys, int queries)
+{
+    Tree t;
+    for(size_t i = 0; i < keys.size(); ++i) {
+        t.insert(make_pair(keys[i], keys[i]));
+    }
+    mt19937 rng(5);
+    vector<size_t> ranks(queries);
+    for(int q = 0; q < queries; ++q) {
+        ranks[q] = rng() % keys.size();
+    }
+
+    long long sum = 0;
+    Clock::time_point start = Clock::now();
+    for(int q = 0; q < queries; ++q) {
+        typename Tree::iterator it = t.begin();
+        for(size_t i = 0; i < ranks[q]; ++i) {
+            ++it;
+        }
+        sum += it->first;
+    }
+    report("walk", tree + " x" + to_string(queries), msSince(start));
+
+    start = Clock::now();
+    for(int q = 0; q < queries; ++q) {
+        sum -= t.select(ranks[q])->first;
+    }
+    report("select", tree + " x" + to_string(queries), msSince(start));
+    sink = sum; // 0 when both agree
+}
+
+// Sums over key ranges: iterating from lower_bound() versus
+// rangeAggregate() on a tree that caches subtree sums.
+template<typename Tree>
+void benchRangeSum(const string& tree, const vector<int>& keys, int queries)
+{
+    Tree t;
+    for(size_t i = 0; i < keys.size(); ++i) {
+        t.insert(make_pair(keys[i], (long long)keys[i]));
+    }
+    mt19937 rng(6);
+    vector<pair<int,int> > ranges(queries);
+    for(int q = 0; q < queries; ++q) {
+        int lo = static_cast<int>(rng() % (2u * keys.size()));
+        ranges[q] = make_pair(lo, lo + static_cast<int>(rng() % keys.size()));
+    }
+
+    long long sum = 0;
+    Clock::time_point start = Clock::now();
+    for(int q = 0; q < queries; ++q) {
+        for(typename Tree::iterator it = t.lower_bound(ranges[q].first);
+            it != t.end() && it->first <= ranges[q].second; ++it) {
+            sum += it->second;
+        }
+    }
+    report("iterate", tree + " x" + to_string(queries), msSince(start));
+
+    start = Clock::now();
+    for(int q = 0; q < queries; ++q) {
+        sum -= t.rangeAggregate(ranges[q].first, ranges[q].second);
+    }
+    report("aggregate", tree + " x" + to_string(queries), msSince(start));
+    sink = sum; // 0 when both agree
+}
+
+// Point queries over intervals: checking every interval versus stab()
+// on an IntervalTree.
+static void benchStab(const vector<int>& keys, int queries)
+{
+    IntervalTree<int> t;
+    mt19937 rng(10);
+    for(size_t i = 0; i < keys.size(); ++i) {
+        t.insert(make_pair(keys[i], keys[i] + 1 + static_cast<int>(rng() % 100)));
+    }
+    vector<int> points(queries);
+    for(int q = 0; q < queries; ++q) {
+        points[q] = static_cast<int>(rng() % (2u * keys.size()));
+    }
+
+    long long found = 0;
+    Clock::time_point start = Clock::now();
+    for(int q = 0; q < queries; ++q) {
+        for(IntervalTree<int>::iterator it = t.begin(); it != t.end() && it->first <= points[q]; ++it) {
+            if(points[q] < it->second) ++found;
+        }
+    }
+    report("scan", "IntervalTree x" + to_string(queries), msSince(start));
+
+    vector<IntervalTree<int>::iterator> hits;
+    start = Clock::now();
+    for(int q = 0; q < queries; ++q) {
+        hits.clear();
+        t.stab(points[q], back_inserter(hits));
+        found -= hits.size();
+    }
+    report("stab", "IntervalTree x" + to_string(queries), msSince(start));
+    sink = found; // 0 when both agree
+}
+
+// Moving the upper half of the keys into another tree: remove() and
+// insert() per key versus split(), then back with join(). Only a tree
+// whose nodes count their subtrees splits in O(log n); a plain AVLTree
+// walks one half to keep size() exact.
+template<typename Tree>
+void benchSplit(const string& tree, const vector<int>& keys)
+{
+    Tree trees[2];
+    for(size_t i = 0; i < keys.size(); ++i) {
+        trees[0].insert(make_pair(keys[i], keys[i]));
+        trees[1].insert(make_pair(keys[i], keys[i]));
+    }
+    int boundary = static_cast<int>(keys.size());
+
+    Tree upper;
+    Clock::time_point start = Clock::now();
+    vector<int> moving;
+    for(typename Tree::iterator it = trees[0].lower_bound(boundary); it != trees[0].end(); ++it) {
+        moving.push_back(it->first);
+    }
+    for(size_t i = 0; i < moving.size(); ++i) {
+        upper.insert(make_pair(moving[i], trees[0][moving[i]]));
+        trees[0].remove(moving[i]);
+    }
+    report("per key", tree, msSince(start));
+
+    Tree upper2;
+    start = Clock::now();
+    trees[1].split(boundary, upper2);
+    report("split", tree, msSince(start));
+    start = Clock::now();
+    trees[1].join(upper2);
+    report("join", tree, msSince(start));
+    sink = trees[1].size() + upper.size();
+}
+
+// Expiring the oldest tenth of the keys: remove() per key versus
+// removeRange().
+template<typename Tree>
+void benchRemoveRange(const string& tree, const vector<int>& keys)
+{
+    Tree trees[2];
+    for(size_t i = 0; i < keys.size(); ++i) {
+        trees[0].insert(make_pair(keys[i], keys[i]));
+        trees[1].insert(make_pair(keys[i], keys[i]));
+    }
+    int cutoff = static_cast<int>(keys.size() / 5);   // keys are 0, 2, 4, ...
+
+    Clock::time_point start = Clock::now();
+    for(int k = 0; k < cutoff; k += 2) {
+        trees[0].remove(k);
+    }
+    report("per key", tree, msSince(start));
+    start = Clock::now();
+    trees[1].removeRange(0, cutoff - 1);
+    report("removeRange", tree, msSince(start));
+    sink = trees[0].size() + trees[1].size();
+}
+
+// Merging a tree of half as many keys, half of them shared: insert() per
+// key versus unionWith(), then intersectWith(), serially and on a pool.
+template<typename Tree>
+void benchSetOps(const string& tree, const vector<int>& keys)
+{
+    Tree trees[5];
+    Tree others[5];
+    for(size_t i = 0; i < keys.size(); ++i) {
+        for(int t = 0; t < 5; ++t) {
+            trees[t].insert(make_pair(keys[i], keys[i]));
+            if(i % 2 == 0) {
+                others[t].insert(make_pair(keys[i] + (i % 4 == 0 ? 0 : 1), keys[i]));
+            }
+        }
+    }
+    ThreadPool pool;
+    string pooled = tree + " x" + to_string(pool.size());
+
+    Clock::time_point start = Clock::now();
+    for(typename Tree::iterator it = others[0].begin(); it != others[0].end(); ++it) {
+        trees[0].insert(*it);
+    }
+    report("insert", tree, msSince(start));
+
+    start = Clock::now();
+    trees[1].unionWith(others[1]);
+    report("union", tree, msSince(start));
+    start = Clock::now();
+    trees[2].unionWith(others[2], pool);
+    report("union", pooled, msSince(start));
+    start = Clock::now();
+    trees[3].intersectWith(others[3]);
+    report("intersect", tree, msSince(start));
+    start = Clock::now();
+    trees[4].intersectWith(others[4], pool);
+    report("intersect", pooled, msSince(start));
+    sink = trees[0].size() + trees[1].size() + trees[2].size() + trees[3].size() + trees[4].size();
+}
+
+// Keys sharing a long prefix, so every comparison walks most of the string.
+template<typename Tree>
+void benchStrings(const string& tree, const vector<int>& keys, const vector<int>& probes)
+{
+    vector<string> names(keys.size());
+    for(size_t i = 0; i < keys.size(); ++i) {
+        names[i] = "customer/account/" + to_string(keys[i]);
+    }
+    vector<string> probeNames(probes.size());
+    for(size_t i = 0; i < probes.size(); ++i) {
+        probeNames[i] = "customer/account/" + to_string(probes[i]);
+    }
+
+    Tree t;
+    Clock::time_point start = Clock::now();
+    for(size_t i = 0; i < names.size(); ++i) {
+        t.insert(make_pair(names[i], keys[i]));
+    }
+    report("insert", tree, msSince(start));
+
+    long long found = 0;
+    start = Clock::now();
+    for(size_t i = 0; i < probeNames.size(); ++i) {
+        if(t.find(probeNames[i]) != t.end()) {
+            ++found;
+        }
+    }
+    report("find", tree, msSince(start));
+    sink = found;
+}
+
+// Many tiny maps, the case the inline array of SmallTree is aimed at.
+template<typename Tree>
+void benchSmall(const string& tree, int maps, int perMap)
+{
+    mt19937 rng(7);
+    vector<int> keys(perMap);
+    for(int i = 0; i < perMap; ++i) {
+        keys[i] = i * 2;
+    }
+
+    Clock::time_point start = Clock::now();
+    vector<Tree> trees(maps);
+    for(int m = 0; m < maps; ++m) {
+        shuffle(keys.begin(), keys.end(), rng);
+        for(int i = 0; i < perMap; ++i) {
+            trees[m].insert(make_pair(keys[i], keys[i]));
+        }
+    }
+    report("insert", tree, msSince(start));
+
+    long long found = 0;
+    start = Clock::now();
+    for(int pass = 0; pass < 10; ++pass) {
+        for(int m = 0; m < maps; ++m) {
+            if(trees[m].find(static_cast<int>(rng() % (2u * perMap))) != trees[m].end()) {
+                ++found;
+            }
+        }
+    }
+    report("find x10", tree, msSince(start));
+
+    start = Clock::now();
+    trees.clear();
+    report("destroy", tree, msSince(start));
+    sink = found;
+}
+
+int main(int argc, char *argv[])
+{
+    int n = argc > 1 ? atoi(argv[1]) : 1000000;
+
+    mt19937 rng(12345);
+    vector<int> keys(n);
+    for(int i = 0; i < n; ++i) {
+        keys[i] = i * 2;
+    }
+    shuffle(keys.begin(), keys.end(), rng);
+    vector<int> probes(n);
+    for(int i = 0; i < n; ++i) {
+        probes[i] = static_cast<int>(rng() % (2u * n));
+    }
+
+    cout << "keys: " << n << endl;
+    benchLookup<AVLTree<int,int>, int>("AVLTree", keys, probes);
+    benchLookup<AVLTree<int,int,less<int>,NodePool<> >, int>("AVLTree+NodePool", keys, probes);
+    benchLookup<IndexedAVLTree<int,int>, int>("IndexedAVLTree", keys, probes);
+    benchLookup<PathAVLTree<int,int>, int>("PathAVLTree", keys, probes);
+    benchLookup<CountedAVLTree<int,int>, int>("CountedAVLTree", keys, probes);
+
+    benchLookup<RedBlackTree<int,int>, int>("RedBlackTree", keys, probes);
+    benchLookup<BTreeMap<int,int>, int>("BTreeMap", keys, probes);
+
+    cout << "operation mixes" << endl;
+    benchMix<AVLTree<int,int> >("AVLTree", keys, probes, 90);
+    benchMix<RedBlackTree<int,int> >("RedBlackTree", keys, probes, 90);
+    benchMix<BTreeMap<int,int> >("BTreeMap", keys, probes, 90);
+    benchMix<AVLTree<int,int> >("AVLTree", keys, probes, 10);
+    benchMix<RedBlackTree<int,int> >("RedBlackTree", keys, probes, 10);
+    benchMix<BTreeMap<int,int> >("BTreeMap", keys, probes, 10);
+
+    cout << "skewed finds" << endl;
+    vector<int> zipf = zipfTrace(keys, n, 1.0, rng);
+    vector<int> mild = zipfTrace(keys, n, 0.8, rng);
+    vector<int> steep = zipfTrace(keys, n, 2.0, rng);
+    vector<int> skewed = zipfTrace(keys, n, 1.5, rng);
+    benchTrace<AVLTree<int,int> >("zipf 2.0", "AVLTree", keys, steep);
+    benchTrace<SplayTree<int,int> >("zipf 2.0", "SplayTree", keys, steep);
+    benchTrace<AVLTree<int,int> >("zipf 1.5", "AVLTree", keys, skewed);
+    benchTrace<SplayTree<int,int> >("zipf 1.5", "SplayTree", keys, skewed);
+    benchTrace<AVLTree<int,int> >("zipf 1.0", "AVLTree", keys, zipf);
+    benchTrace<SplayTree<int,int> >("zipf 1.0", "SplayTree", keys, zipf);
+    benchTrace<AVLTree<int,int> >("zipf 0.8", "AVLTree", keys, mild);
+    benchTrace<SplayTree<int,int> >("zipf 0.8", "SplayTree", keys, mild);
+    benchTrace<AVLTree<int,int> >("uniform", "AVLTree", keys, probes);
+    benchTrace<SplayTree<int,int> >("uniform", "SplayTree", keys, probes);
+
+    cout << "zipf 1.0, profiled then replayed" << endl;
+    benchOptimized(keys, zipfTrace(keys, 2 * static_cast<size_t>(n), 1.0, rng));
+
+    cout << "200-byte values" << endl;
+    benchLookup<AVLTree<int,Record>, Record>("AVLTree", keys, probes);
+    benchLookup<AVLTree<int,Record,less<int>,NodePool<> >, Record>("AVLTree+NodePool", keys, probes);
+    benchLookup<SplitAVLTree<int,Record>, Record>("SplitAVLTree", keys, probes);
+    benchLookup<BTreeMap<int,Record>, Record>("BTreeMap", keys, probes);
+
+    cout << "after churn" << endl;
+    benchCompact<AVLTree<int,int,less<int>,NodePool<> > >("AVLTree", keys, probes);
+
+    cout << "sorted load" << endl;
+    benchSortedLoad<AVLTree<int,int> >("AVLTree", n);
+    benchSortedLoad<AVLTree<int,int,less<int>,NodePool<> > >("AVLTree+NodePool", n);
+
+    cout << "sorted load into a plain BST, " << min(n, 20000) << " keys" << endl;
+    benchDegenerate(min(n, 20000));
+
+    cout << "10 batches into the tree" << endl;
+    benchBatch<AVLTree<int,int> >("AVLTree", keys, 10000);
+    benchBatch<AVLTree<int,int> >("AVLTree", keys, 100000);
+
+    cout << "augmented trees" << endl;
+    benchSelect<CountedAVLTree<int,int> >("CountedAVLTree", keys, 100);
+    benchRangeSum<AggregateAVLTree<int,long long,SumMonoid<long long> > >("AggregateAVLTree", keys, 100);
+    benchStab(keys, 100);
+
+    cout << "half the keys to another tree" << endl;
+    benchSplit<AVLTree<int,int> >("AVLTree", keys);
+    benchSplit<CountedAVLTree<int,int> >("CountedAVLTree", keys);
+
+    cout << "expire a tenth of the keys" << endl;
+    benchRemoveRange<AVLTree<int,int> >("AVLTree", keys);
+
+    cout << "set operations" << endl;
+    benchSetOps<AVLTree<int,int> >("AVLTree", keys);
+
+    cout << "string keys" << endl;
+    benchStrings<AVLTree<string,int> >("AVLTree", keys, probes);
+
+    cout << "maps of 8 keys" << endl;
+    benchSmall<AVLTree<int,int> >("AVLTree", n / 8, 8);
+    benchSmall<SmallTree<int,int,16> >("SmallTree", n / 8, 8);
+    return 0;
+}
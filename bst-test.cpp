@@ -1,10 +1,36 @@
 #include <iostream>
+#include <iterator>
 #include <map>
+#include <string>
+#include <vector>
 #include "bst.h"
 #include "avlbst.h"
+#include "pathavl.h"
+#include "small_tree.h"
+#include "interval_tree.h"
+#include "redblack.h"
+#include "splay.h"
+#include "thread_pool.h"
+#include "btree.h"
 
 using namespace std;
 
+// Lets nodesLeft nodes be created, then fails every further allocation;
+// a negative count never runs out
+struct FailingNodeAllocator : NewDeleteNodeAllocator
+{
+    static int nodesLeft;
+
+    template<typename NodeType, typename... Args>
+    NodeType* create(Args&&... args)
+    {
+        if(nodesLeft == 0) throw std::bad_alloc();
+        --nodesLeft;
+        return NewDeleteNodeAllocator::create<NodeType>(std::forward<Args>(args)...);
+    }
+};
+int FailingNodeAllocator::nodesLeft = -1;
+
 
 int main(int argc, char *argv[])
 {
@@ -28,6 +54,41 @@ int main(int argc, char *argv[])
     cout << "Erasing b" << endl;
     bt.remove('b');
 
+    // Sorted inserts leave a plain BST a path until it is rebalanced
+    BinarySearchTree<int,int> pathTree;
+    BinarySearchTree<int,int> healingTree;
+    healingTree.setAutoRebalance(2);
+    for(int i = 0; i < 100; ++i) {
+        pathTree.insert(std::make_pair(i, i));
+        healingTree.insert(std::make_pair(i, i));
+    }
+    cout << "Sorted BST balanced: " << pathTree.isBalanced();
+    pathTree.rebalance();
+    cout << ", after rebalance: " << pathTree.isBalanced()
+         << ", [42]: " << pathTree[42] << ", size: " << pathTree.size() << endl;
+    cout << "Auto-rebalanced BST [99]: " << healingTree[99] << endl;
+    AVLTree<int,int> selfBalancing;
+    try {
+        selfBalancing.setAutoRebalance(2);
+        cout << "AVLTree took setAutoRebalance(2)" << endl;
+    }
+    catch(std::logic_error& e) {
+        cout << "AVLTree rejected setAutoRebalance(2)" << endl;
+    }
+
+    // Reshaping around the keys find() returns most
+    HitCountTree<int,int> ht;
+    for(int i = 0; i < 100; ++i) {
+        ht.insert(std::make_pair((i * 37) % 100, i));
+    }
+    for(int i = 0; i < 50; ++i) {
+        ht.find(90);
+        ht.find(i % 5);
+    }
+    ht.optimizeForAccess();
+    cout << "Optimized BST size: " << ht.size() << ", first: " << ht.begin()->first
+         << ", find(90): " << ht.find(90)->second << endl;
+
     // AVL Tree Tests
     AVLTree<char,int> at;
     at.insert(std::make_pair('a',1));
@@ -46,5 +107,290 @@ int main(int argc, char *argv[])
     cout << "Erasing b" << endl;
     at.remove('b');
 
+    // Red-Black Tree Tests
+    RedBlackTree<int,int> rt;
+    for(int i = 0; i < 100; ++i) {
+        rt.insert(std::make_pair(i, i));
+    }
+    for(int i = 0; i < 100; i += 3) {
+        rt.remove(i);
+    }
+    cout << "\nRedBlackTree size: " << rt.size() << ", first: " << rt.begin()->first
+         << ", last: " << rt.last()->first << ", valid: " << rt.isValidRedBlack() << endl;
+
+    // Splay Tree Tests
+    SplayTree<int,int> yt;
+    for(int i = 0; i < 100; ++i) {
+        yt.insert(std::make_pair(i, i * 2));
+    }
+    yt.remove(50);
+    cout << "\nSplayTree find(70): " << yt.find(70)->second
+         << ", find(50) is end: " << (yt.find(50) == yt.end())
+         << ", size: " << yt.size() << ", first: " << yt.begin()->first << endl;
+    // Overwriting a value splays the existing node like any other insert
+    SplayTree<int,int> yo;
+    for(int i = 1; i <= 4; ++i) {
+        yo.insert(std::make_pair(i, i));
+    }
+    yo.insert(std::make_pair(1, 10));
+    cout << "SplayTree after overwriting 1 (root on top):" << endl;
+    yo.print();
+    // find() moves only deep hits, and those about halfway up
+    SplayTree<int,int> yd;
+    for(int i = 1; i <= 8; ++i) {
+        yd.insert(std::make_pair(i, i));
+    }
+    yd.find(7);
+    yd.find(9);
+    yd.find(1);
+    cout << "SplayTree path of 8 after find(7), find(9), find(1):" << endl;
+    yd.print();
+
+    // AVL Tree backed by a node pool
+    AVLTree<int,int,std::less<int>,NodePool<> > pt;
+    for(int i = 0; i < 1000; ++i) {
+        pt.insert(std::make_pair(i, i * i));
+    }
+    for(int i = 0; i < 1000; i += 2) {
+        pt.remove(i);
+    }
+    pt.compact(VAN_EMDE_BOAS);
+    cout << "\nPooled AVLTree balanced: " << pt.isBalanced() << endl;
+    cout << "Pooled AVLTree [999]: " << pt[999] << endl;
+    cout << "Pooled AVLTree size: " << pt.size() << ", first " << pt.begin()->first
+         << ", last " << pt.last()->first << endl;
+    pt.clear();
+    cout << "Pooled AVLTree empty after clear: " << pt.empty() << endl;
+
+    // AVL Tree bulk loaded from sorted items
+    std::vector<std::pair<int,int> > sorted;
+    for(int i = 0; i < 100; ++i) {
+        sorted.push_back(std::make_pair(i, i));
+    }
+    AVLTree<int,int> lt(sorted.begin(), sorted.end());
+    cout << "\nLoaded AVLTree size: " << lt.size() << ", balanced: " << lt.isBalanced() << endl;
+    std::vector<std::pair<int,int> > batch;
+    for(int i = 250; i >= 50; i -= 50) {
+        batch.push_back(std::make_pair(i, -i));
+    }
+    lt.insertBatch(batch.begin(), batch.end());
+    cout << "After batch size: " << lt.size() << ", [50]: " << lt[50] << ", balanced: " << lt.isBalanced() << endl;
+    AVLTree<int,int>::iterator hint = lt.find(10);
+    hint = lt.insert(hint, std::make_pair(-1, 1));
+    lt.insert(hint, std::make_pair(300, 3));
+    cout << "After hinted inserts first: " << lt.begin()->first << ", last: " << lt.last()->first
+         << ", balanced: " << lt.isBalanced() << endl;
+
+    // Ordered lookups over keys -1..100, 150, 200, 250, 300
+    cout << "lower_bound(120): " << lt.lower_bound(120)->first
+         << ", upper_bound(150): " << lt.upper_bound(150)->first
+         << ", floor(120): " << lt.floor(120)->first
+         << ", ceiling(50): " << lt.ceiling(50)->first << endl;
+    cout << "floor(-5) is end: " << (lt.floor(-5) == lt.end())
+         << ", upper_bound(300) is end: " << (lt.upper_bound(300) == lt.end()) << endl;
+    cout << "Keys in [95, 200]:";
+    AVLTree<int,int>::iterator stop = lt.upper_bound(200);
+    for(AVLTree<int,int>::iterator rit = lt.lower_bound(95); rit != stop; ++rit) {
+        cout << " " << rit->first;
+    }
+    cout << endl;
+
+    // AVL Tree whose nodes count their subtrees
+    CountedAVLTree<int,int> ot;
+    for(int i = 0; i < 1000; ++i) {
+        ot.insert(std::make_pair(i * 10, i));
+    }
+    for(int i = 0; i < 1000; i += 2) {
+        ot.remove(i * 10);
+    }
+    cout << "\nCountedAVLTree select(0): " << ot.select(0)->first
+         << ", select(250): " << ot.select(250)->first
+         << ", rank(5000): " << ot.rank(5000)
+         << ", countRange(100, 200): " << ot.countRange(100, 200) << endl;
+
+    // AVL Tree caching value sums per subtree
+    AggregateAVLTree<int,long,SumMonoid<long> > at2;
+    for(int i = 1; i <= 100; ++i) {
+        at2.insert(std::make_pair(i, long(i)));
+    }
+    at2.insert_or_assign(50, 0L);
+    at2.remove(10);
+    cout << "\nAggregateAVLTree sum [1, 100]: " << at2.rangeAggregate(1, 100)
+         << ", sum [5, 15]: " << at2.rangeAggregate(5, 15)
+         << ", sum [200, 300]: " << at2.rangeAggregate(200, 300) << endl;
+
+    // Intervals [start, end) keyed by start
+    IntervalTree<int> iv;
+    iv.insert(std::make_pair(0, 10));
+    iv.insert(std::make_pair(5, 8));
+    iv.insert(std::make_pair(12, 20));
+    iv.insert(std::make_pair(15, 16));
+    std::vector<IntervalTree<int>::iterator> hits;
+    iv.stab(7, std::back_inserter(hits));
+    cout << "\nIntervals containing 7:";
+    for(size_t i = 0; i < hits.size(); ++i) {
+        cout << " [" << hits[i]->first << ", " << hits[i]->second << ")";
+    }
+    hits.clear();
+    iv.overlapping(9, 15, std::back_inserter(hits));
+    cout << "\nIntervals meeting [9, 15):";
+    for(size_t i = 0; i < hits.size(); ++i) {
+        cout << " [" << hits[i]->first << ", " << hits[i]->second << ")";
+    }
+    cout << endl;
+
+    // Moving every key from 60 up into another tree, and back
+    AVLTree<int,int> upper;
+    lt.split(60, upper);
+    cout << "\nSplit at 60 sizes: " << lt.size() << " and " << upper.size()
+         << ", upper first: " << upper.begin()->first
+         << ", balanced: " << lt.isBalanced() << upper.isBalanced() << endl;
+    lt.join(upper);
+    cout << "Joined size: " << lt.size() << ", last: " << lt.last()->first
+         << ", balanced: " << lt.isBalanced() << ", other empty: " << upper.empty() << endl;
+    cout << "removeRange(20, 79): " << lt.removeRange(20, 79);
+    cout << ", erase from 150: " << lt.erase(lt.lower_bound(150), lt.end())
+         << ", size: " << lt.size() << ", last: " << lt.last()->first
+         << ", balanced: " << lt.isBalanced() << endl;
+
+    // Set operations on keys 0..9 and the even keys 4..14
+    AVLTree<int,int> sa, sb;
+    for(int i = 0; i < 10; ++i) {
+        sa.insert(std::make_pair(i, i));
+        sb.insert(std::make_pair(i + 4 + i % 2, -i));
+    }
+    AVLTree<int,int> sc(sa.begin(), sa.end()), sd(sb.begin(), sb.end());
+    ThreadPool pool(2);
+    sa.unionWith(sb, pool);
+    sc.intersectWith(sd);
+    cout << "\nUnion size: " << sa.size() << ", [12]: " << sa[12] << ", [4]: " << sa[4]
+         << ", balanced: " << sa.isBalanced() << ", other empty: " << sb.empty() << endl;
+    cout << "Intersection:";
+    for(AVLTree<int,int>::iterator xit = sc.begin(); xit != sc.end(); ++xit) {
+        cout << " " << xit->first;
+    }
+    cout << endl;
+    AVLTree<int,int> se(sa.begin(), sa.end()), sf;
+    sf.insert(std::make_pair(0, 0));
+    sf.insert(std::make_pair(14, 0));
+    se.differenceWith(sf);
+    cout << "Difference first: " << se.begin()->first << ", last: " << se.last()->first
+         << ", size: " << se.size() << endl;
+
+    // AVL Tree with 32-bit index links
+    IndexedAVLTree<int,int> it;
+    for(int i = 0; i < 1000; ++i) {
+        it.insert(std::make_pair(i, -i));
+    }
+    for(int i = 0; i < 1000; i += 3) {
+        it.remove(i);
+    }
+    cout << "\nIndexed AVLTree balanced: " << it.isBalanced() << endl;
+    cout << "Indexed AVLTree [998]: " << it[998] << endl;
+
+    // AVL Tree with items stored apart from keys and links
+    SplitAVLTree<int,string> st;
+    st.insert(std::make_pair(2, string("two")));
+    st.insert(std::make_pair(1, string("one")));
+    st[2] = "TWO";
+    cout << "\nSplitAVLTree contents:" << endl;
+    for(SplitAVLTree<int,string>::iterator sit = st.begin(); sit != st.end(); ++sit) {
+        cout << sit->first << " " << sit->second << endl;
+    }
+
+    // In-place insertion reports whether a node was created
+    AVLTree<int,string> et;
+    cout << "\nemplace 1: " << et.emplace(1, string("one")).second << endl;
+    cout << "try_emplace 1: " << et.try_emplace(1, "uno").second << endl;
+    cout << "insert_or_assign 1: " << et.insert_or_assign(1, "ONE").second << endl;
+    cout << "try_emplace 2: " << et.try_emplace(2, 3, 'x').first->second << endl;
+    cout << "[1] = " << et[1] << endl;
+
+    // Custom ordering, and lookups by const char* without building a string
+    AVLTree<string,int,TransparentLess> ct;
+    ct.insert(std::make_pair(string("pear"), 2));
+    ct.insert(std::make_pair(string("apple"), 1));
+    cout << "\nfind(\"pear\"): " << ct.find("pear")->second << endl;
+    AVLTree<int,int,std::greater<int> > gt;
+    for(int i = 1; i <= 3; ++i) {
+        gt.insert(std::make_pair(i, i));
+    }
+    cout << "Descending:";
+    for(AVLTree<int,int,std::greater<int> >::iterator git = gt.begin(); git != gt.end(); ++git) {
+        cout << " " << git->first;
+    }
+    cout << endl;
+
+    // AVL Tree without parent pointers
+    PathAVLTree<char,int> nt;
+    nt.insert(std::make_pair('c',3));
+    nt.insert(std::make_pair('a',1));
+    nt.insert(std::make_pair('b',2));
+    nt.remove('c');
+    cout << "\nPathAVLTree contents:" << endl;
+    for(PathAVLTree<char,int>::iterator pit = nt.begin(); pit != nt.end(); ++pit) {
+        cout << pit->first << " " << pit->second << endl;
+    }
+    cout << "PathAVLTree balanced: " << nt.isBalanced() << ", size: " << nt.size()
+         << ", lower_bound('b'): " << nt.lower_bound('b')->first << endl;
+
+    // Map kept in an inline array until it outgrows four items
+    SmallTree<int,int,4> sm;
+    for(int i = 5; i > 0; --i) {
+        sm.insert(std::make_pair(i, i * 10));
+        if(i == 2) cout << "\nSmallTree inline at 4 items: " << sm.isInline() << endl;
+    }
+    cout << "SmallTree inline at 5 items: " << sm.isInline() << endl;
+    sm.remove(3);
+    for(SmallTree<int,int,4>::iterator smit = sm.begin(); smit != sm.end(); ++smit) {
+        cout << smit->first << " " << smit->second << endl;
+    }
+    // A promotion whose third node cannot be allocated keeps every item
+    typedef AVLTree<int,string,std::less<int>,FailingNodeAllocator> FailingTree;
+    SmallTree<int,string,4,FailingTree> fs;
+    for(int i = 1; i <= 4; ++i) {
+        fs.insert(std::make_pair(i, string(20 * i, 'a')));
+    }
+    FailingNodeAllocator::nodesLeft = 2;
+    try {
+        fs.insert(std::make_pair(5, string(100, 'a')));
+    }
+    catch(std::bad_alloc& e) {
+        cout << "SmallTree promotion failed, inline: " << fs.isInline() << ", sizes:";
+        for(int i = 1; i <= 4; ++i) {
+            cout << " " << fs[i].size();
+        }
+        cout << endl;
+    }
+    FailingNodeAllocator::nodesLeft = -1;
+    fs.insert(std::make_pair(5, string(100, 'a')));
+    cout << "SmallTree promoted on retry: " << !fs.isInline() << ", size: " << fs.size()
+         << ", [4] size: " << fs[4].size() << endl;
+
+    // B+ tree with four children per node, so a few dozen keys split
+    // and merge nodes on several levels
+    BTreeMap<int,int,4> bm;
+    for(int i = 0; i < 40; ++i) {
+        bm.insert(std::make_pair((i * 17) % 40, i));
+    }
+    for(int i = 0; i < 40; i += 3) {
+        bm.remove(i);
+    }
+    cout << "\nBTreeMap size: " << bm.size() << ", height: " << bm.height()
+         << ", [34]: " << bm[34] << endl;
+    for(BTreeMap<int,int,4>::iterator bmit = bm.begin(); bmit != bm.end(); ++bmit) {
+        cout << " " << bmit->first;
+    }
+    cout << endl;
+    // Re-inserting an item of the map itself while the leaf splits
+    BTreeMap<std::string,std::string,4> bs;
+    bs.insert(std::make_pair(std::string("apple"), std::string("red")));
+    bs.insert(std::make_pair(std::string("banana"), std::string("yellow")));
+    bs.insert(std::make_pair(std::string("cherry"), std::string("dark red")));
+    bs.insert(std::make_pair(std::string("damson"), std::string("purple")));
+    bs.insert(*bs.find("cherry"));
+    cout << "BTreeMap self-insert size: " << bs.size() << ", height: " << bs.height()
+         << ", [cherry]: " << bs["cherry"] << endl;
+
     return 0;
 }
\ No newline at end of file
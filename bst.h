@@ -4,21 +4,64 @@
 #include <iostream>
 #include <exception>
 #include <cstdlib>
+#include <functional>
+#include <string>
 #include <utility>
+#include <tuple>
+#include <type_traits>
+#include <new>
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+#include "node_alloc.h"
+
+/**
+ * Resolves the concrete node type of Node<Key, Value, Derived>: Derived
+ * when a search tree supplies its own node class, Node itself otherwise.
+ */
+template <typename Self, typename Derived>
+struct NodeSelf
+{
+    typedef Derived type;
+};
+
+template <typename Self>
+struct NodeSelf<Self, void>
+{
+    typedef Self type;
+};
+
+/**
+ * Selects the node constructors that build the item in place, passing
+ * the remaining arguments on to the std::pair<const Key, Value>
+ * constructor, as emplace() and friends do.
+ */
+struct EmplaceTag
+{
+};
 
 /**
  * A templated class for a Node in a search tree.
- * The getters for parent/left/right are virtual so
- * that they can be overridden for future kinds of
- * search trees, such as Red Black trees, Splay trees,
- * and AVL trees.
+ * Nodes for other kinds of search trees, such as Red Black trees,
+ * Splay trees, and AVL trees, derive from Node and pass themselves
+ * as Derived. The getters for parent/left/right then return the
+ * derived type directly, so there are no virtual calls and no
+ * vtable pointer in any node.
  */
-template <typename Key, typename Value>
+template <typename Key, typename Value, typename Derived = void>
 class Node
 {
 public:
-    Node(const Key& key, const Value& value, Node<Key, Value>* parent);
-    virtual ~Node();
+    typedef typename NodeSelf<Node, Derived>::type NodeType;
+
+    Node(const Key& key, const Value& value, NodeType* parent);
+    template<typename... Args>
+    Node(EmplaceTag, NodeType* parent, Args&&... args);
+    Node(const Node&) = default;
+    Node(Node&&) = default;   // for compact(); the destructor would hide it
+    ~Node();
 
     const std::pair<const Key, Value>& getItem() const;
     std::pair<const Key, Value>& getItem();
@@ -26,20 +69,20 @@ public:
     const Value& getValue() const;
     Value& getValue();
 
-    virtual Node<Key, Value>* getParent() const;
-    virtual Node<Key, Value>* getLeft() const;
-    virtual Node<Key, Value>* getRight() const;
+    NodeType* getParent() const;
+    NodeType* getLeft() const;
+    NodeType* getRight() const;
 
-    void setParent(Node<Key, Value>* parent);
-    void setLeft(Node<Key, Value>* left);
-    void setRight(Node<Key, Value>* right);
+    void setParent(NodeType* parent);
+    void setLeft(NodeType* left);
+    void setRight(NodeType* right);
     void setValue(const Value &value);
 
 protected:
     std::pair<const Key, Value> item_;
-    Node<Key, Value>* parent_;
-    Node<Key, Value>* left_;
-    Node<Key, Value>* right_;
+    NodeType* parent_;
+    NodeType* left_;
+    NodeType* right_;
 };
 
 /*
@@ -51,8 +94,8 @@ protected:
 /**
 * Explicit constructor for a node.
 */
-template<typename Key, typename Value>
-Node<Key, Value>::Node(const Key& key, const Value& value, Node<Key, Value>* parent) :
+template<typename Key, typename Value, typename Derived>
+Node<Key, Value, Derived>::Node(const Key& key, const Value& value, NodeType* parent) :
     item_(key, value),
     parent_(parent),
     left_(NULL),
@@ -61,13 +104,28 @@ Node<Key, Value>::Node(const Key& key, const Value& value, Node<Key, Value>* par
 
 }
 
+/**
+* Constructs the item in place from args, e.g. a moved pair or the
+* piecewise key and value arguments.
+*/
+template<typename Key, typename Value, typename Derived>
+template<typename... Args>
+Node<Key, Value, Derived>::Node(EmplaceTag, NodeType* parent, Args&&... args) :
+    item_(std::forward<Args>(args)...),
+    parent_(parent),
+    left_(NULL),
+    right_(NULL)
+{
+
+}
+
 /**
 * Destructor, which does not need to do anything since the pointers inside of a node
 * are only used as references to existing nodes. The nodes pointed to by parent/left/right
 * are freed by the BinarySearchTree.
 */
-template<typename Key, typename Value>
-Node<Key, Value>::~Node()
+template<typename Key, typename Value, typename Derived>
+Node<Key, Value, Derived>::~Node()
 {
 
 }
@@ -75,8 +133,8 @@ Node<Key, Value>::~Node()
 /**
 * A const getter for the item.
 */
-template<typename Key, typename Value>
-const std::pair<const Key, Value>& Node<Key, Value>::getItem() const
+template<typename Key, typename Value, typename Derived>
+const std::pair<const Key, Value>& Node<Key, Value, Derived>::getItem() const
 {
     return item_;
 }
@@ -84,8 +142,8 @@ const std::pair<const Key, Value>& Node<Key, Value>::getItem() const
 /**
 * A non-const getter for the item.
 */
-template<typename Key, typename Value>
-std::pair<const Key, Value>& Node<Key, Value>::getItem()
+template<typename Key, typename Value, typename Derived>
+std::pair<const Key, Value>& Node<Key, Value, Derived>::getItem()
 {
     return item_;
 }
@@ -93,8 +151,8 @@ std::pair<const Key, Value>& Node<Key, Value>::getItem()
 /**
 * A const getter for the key.
 */
-template<typename Key, typename Value>
-const Key& Node<Key, Value>::getKey() const
+template<typename Key, typename Value, typename Derived>
+const Key& Node<Key, Value, Derived>::getKey() const
 {
     return item_.first;
 }
@@ -102,8 +160,8 @@ const Key& Node<Key, Value>::getKey() const
 /**
 * A const getter for the value.
 */
-template<typename Key, typename Value>
-const Value& Node<Key, Value>::getValue() const
+template<typename Key, typename Value, typename Derived>
+const Value& Node<Key, Value, Derived>::getValue() const
 {
     return item_.second;
 }
@@ -111,35 +169,35 @@ const Value& Node<Key, Value>::getValue() const
 /**
 * A non-const getter for the value.
 */
-template<typename Key, typename Value>
-Value& Node<Key, Value>::getValue()
+template<typename Key, typename Value, typename Derived>
+Value& Node<Key, Value, Derived>::getValue()
 {
     return item_.second;
 }
 
 /**
-* An implementation of the virtual function for retreiving the parent.
+* A getter for the parent.
 */
-template<typename Key, typename Value>
-Node<Key, Value>* Node<Key, Value>::getParent() const
+template<typename Key, typename Value, typename Derived>
+typename Node<Key, Value, Derived>::NodeType* Node<Key, Value, Derived>::getParent() const
 {
     return parent_;
 }
 
 /**
-* An implementation of the virtual function for retreiving the left child.
+* A getter for the left child.
 */
-template<typename Key, typename Value>
-Node<Key, Value>* Node<Key, Value>::getLeft() const
+template<typename Key, typename Value, typename Derived>
+typename Node<Key, Value, Derived>::NodeType* Node<Key, Value, Derived>::getLeft() const
 {
     return left_;
 }
 
 /**
-* An implementation of the virtual function for retreiving the right child.
+* A getter for the right child.
 */
-template<typename Key, typename Value>
-Node<Key, Value>* Node<Key, Value>::getRight() const
+template<typename Key, typename Value, typename Derived>
+typename Node<Key, Value, Derived>::NodeType* Node<Key, Value, Derived>::getRight() const
 {
     return right_;
 }
@@ -147,8 +205,8 @@ Node<Key, Value>* Node<Key, Value>::getRight() const
 /**
 * A setter for setting the parent of a node.
 */
-template<typename Key, typename Value>
-void Node<Key, Value>::setParent(Node<Key, Value>* parent)
+template<typename Key, typename Value, typename Derived>
+void Node<Key, Value, Derived>::setParent(NodeType* parent)
 {
     parent_ = parent;
 }
@@ -156,8 +214,8 @@ void Node<Key, Value>::setParent(Node<Key, Value>* parent)
 /**
 * A setter for setting the left child of a node.
 */
-template<typename Key, typename Value>
-void Node<Key, Value>::setLeft(Node<Key, Value>* left)
+template<typename Key, typename Value, typename Derived>
+void Node<Key, Value, Derived>::setLeft(NodeType* left)
 {
     left_ = left;
 }
@@ -165,8 +223,8 @@ void Node<Key, Value>::setLeft(Node<Key, Value>* left)
 /**
 * A setter for setting the right child of a node.
 */
-template<typename Key, typename Value>
-void Node<Key, Value>::setRight(Node<Key, Value>* right)
+template<typename Key, typename Value, typename Derived>
+void Node<Key, Value, Derived>::setRight(NodeType* right)
 {
     right_ = right;
 }
@@ -174,8 +232,8 @@ void Node<Key, Value>::setRight(Node<Key, Value>* right)
 /**
 * A setter for the value of a node.
 */
-template<typename Key, typename Value>
-void Node<Key, Value>::setValue(const Value& value)
+template<typename Key, typename Value, typename Derived>
+void Node<Key, Value, Derived>::setValue(const Value& value)
 {
     item_.second = value;
 }
@@ -187,23 +245,252 @@ void Node<Key, Value>::setValue(const Value& value)
 */
 
 /**
-* A templated unbalanced binary search tree.
+* A Node that counts how often find() has returned it, for
+* BinarySearchTree::optimizeForAccess(). The count saturates rather than
+* wrapping.
 */
 template <typename Key, typename Value>
+class HitCountNode : public Node<Key, Value, HitCountNode<Key, Value> >
+{
+public:
+    typedef void counts_hits;
+
+    HitCountNode(const Key& key, const Value& value, HitCountNode<Key, Value>* parent) :
+        Node<Key, Value, HitCountNode<Key, Value> >(key, value, parent), hits_(0)
+    {
+    }
+    template<typename... Args>
+    HitCountNode(EmplaceTag tag, HitCountNode<Key, Value>* parent, Args&&... args) :
+        Node<Key, Value, HitCountNode<Key, Value> >(tag, parent, std::forward<Args>(args)...), hits_(0)
+    {
+    }
+
+    uint32_t getHits() const { return hits_; }
+    void recordHit() { if (hits_ != UINT32_MAX) ++hits_; }
+    void clearHits() { hits_ = 0; }
+
+protected:
+    uint32_t hits_;
+};
+
+// Node variant with 32-bit index links (in its own file with its arena)
+#include "index_node.h"
+// Node variant with out-of-line items (in its own file with its allocator)
+#include "split_node.h"
+
+/**
+* Node orders for BinarySearchTree::compact().
+*/
+enum CompactOrder
+{
+    IN_ORDER,       // sorted, for iteration
+    VAN_EMDE_BOAS   // recursive top/bottom split, for lookups at every size of cache
+};
+
+/**
+* A less-than that accepts any two operands, like std::less<> in later
+* standards. It is transparent, so a tree ordered by it can be searched
+* with anything comparable to its keys, e.g. a const char* in a tree of
+* std::string, without building a temporary Key.
+*/
+struct TransparentLess
+{
+    typedef void is_transparent;
+
+    template<typename A, typename B>
+    bool operator()(const A& a, const B& b) const
+    {
+        return a < b;
+    }
+};
+
+/**
+* Three-way comparison through a tree's Compare: negative, zero or
+* positive as a orders before, with or after b. The general version may
+* call comp twice; specializations answer with one call for comparators
+* that know a cheaper way, as std::string::compare does.
+*/
+template <typename Compare>
+struct KeyOrder
+{
+    template<typename A, typename B>
+    static int compare(const Compare& comp, const A& a, const B& b)
+    {
+        return comp(a, b) ? -1 : (comp(b, a) ? 1 : 0);
+    }
+};
+
+template <typename CharT, typename Traits, typename Alloc>
+struct KeyOrder<std::less<std::basic_string<CharT, Traits, Alloc> > >
+{
+    typedef std::basic_string<CharT, Traits, Alloc> String;
+
+    static int compare(const std::less<String>&, const String& a, const String& b)
+    {
+        return a.compare(b);
+    }
+};
+
+template <>
+struct KeyOrder<TransparentLess>
+{
+    template<typename A, typename B>
+    static int compare(const TransparentLess& comp, const A& a, const B& b)
+    {
+        return comp(a, b) ? -1 : (comp(b, a) ? 1 : 0);
+    }
+
+    template<typename CharT, typename Traits, typename Alloc>
+    static int compare(const TransparentLess&, const std::basic_string<CharT, Traits, Alloc>& a,
+                       const std::basic_string<CharT, Traits, Alloc>& b)
+    {
+        return a.compare(b);
+    }
+
+    template<typename CharT, typename Traits, typename Alloc>
+    static int compare(const TransparentLess&, const std::basic_string<CharT, Traits, Alloc>& a, const CharT* b)
+    {
+        return a.compare(b);
+    }
+
+    template<typename CharT, typename Traits, typename Alloc>
+    static int compare(const TransparentLess&, const CharT* a, const std::basic_string<CharT, Traits, Alloc>& b)
+    {
+        return -b.compare(a);
+    }
+};
+
+/**
+* Enables a heterogeneous overload only when Compare is transparent.
+* Probe is unused but makes the lookup depend on the overload's own
+* template parameter, so a plain Compare removes it instead of failing.
+*/
+template <typename T>
+struct AlwaysVoid
+{
+    typedef void type;
+};
+
+template <typename Compare, typename Probe, typename Result, typename = void>
+struct IfTransparent
+{
+};
+
+template <typename Compare, typename Probe, typename Result>
+struct IfTransparent<Compare, Probe, Result, typename AlwaysVoid<typename Compare::is_transparent>::type>
+{
+    typedef Result type;
+};
+
+/**
+* True for node types that keep data summarizing their subtree (e.g.
+* CountedAVLNode) and declare `typedef void is_augmented;`. Such a node
+* provides refresh(), which recomputes its summary from its children;
+* the tree calls it wherever links change and wherever insert() and
+* insert_or_assign() overwrite a value. A value changed through
+* operator[] or an iterator is not seen, so summaries that depend on
+* values must be updated through those calls. Other nodes pay nothing.
+*/
+template <typename NodeType, typename = void>
+struct IsAugmented : std::false_type
+{
+};
+
+template <typename NodeType>
+struct IsAugmented<NodeType, typename AlwaysVoid<typename NodeType::is_augmented>::type> : std::true_type
+{
+};
+
+/**
+* True for augmented node types that count the nodes in their subtree
+* (CountedAVLNode), declaring `typedef void counts_subtree;`. Code that
+* needs the size of a detached subtree reads it in O(1) from these.
+*/
+template <typename NodeType, typename = void>
+struct CountsSubtree : std::false_type
+{
+};
+
+template <typename NodeType>
+struct CountsSubtree<NodeType, typename AlwaysVoid<typename NodeType::counts_subtree>::type> : std::true_type
+{
+};
+
+/**
+* True for node types that count find() hits (HitCountNode), declaring
+* `typedef void counts_hits;`. Other nodes pay nothing.
+*/
+template <typename NodeType, typename = void>
+struct CountsHits : std::false_type
+{
+};
+
+template <typename NodeType>
+struct CountsHits<NodeType, typename AlwaysVoid<typename NodeType::counts_hits>::type> : std::true_type
+{
+};
+
+/**
+* False when a node's summary_type (see AggregateAVLNode) needs its
+* destructor run, so clear() cannot just drop the nodes.
+*/
+template <typename NodeType, typename = void>
+struct HasTrivialSummary : std::true_type
+{
+};
+
+template <typename NodeType>
+struct HasTrivialSummary<NodeType, typename AlwaysVoid<typename NodeType::summary_type>::type> :
+    std::is_trivially_destructible<typename NodeType::summary_type>
+{
+};
+
+/**
+* A templated unbalanced binary search tree.
+* Keys are ordered by Compare, which defaults to std::less<Key>; each
+* visited node costs one KeyOrder<Compare>::compare() call.
+* NodeType is the node class the tree links together; derived trees
+* such as AVLTree pass their own Node subclass.
+*/
+template <typename Key, typename Value, typename Compare = std::less<Key>,
+          typename NodeAlloc = NewDeleteNodeAllocator,
+          typename NodeType = Node<Key, Value> >
 class BinarySearchTree
 {
 public:
+    typedef Compare key_compare;
+
     BinarySearchTree(); //TODO
+    explicit BinarySearchTree(const Compare& comp);
+    template<typename ForwardIt>
+    BinarySearchTree(ForwardIt first, ForwardIt last, const Compare& comp = Compare());
     virtual ~BinarySearchTree(); //TODO
-    virtual void insert(const std::pair<const Key, Value>& keyValuePair); //TODO
     virtual void remove(const Key& key); //TODO
     void clear(); //TODO
+    template<typename ForwardIt>
+    void assign(ForwardIt first, ForwardIt last);
+    template<typename ForwardIt>
+    void insertBatch(ForwardIt first, ForwardIt last);
     bool isBalanced() const; //TODO
+    void compact(CompactOrder order = IN_ORDER);
+    // Reshapes the tree with Day-Stout-Warren into a complete one (every
+    // level full but the bottom, which fills from the left), in O(n) time
+    // with O(1) extra memory.
+    void rebalance();
+    // When factor > 1, an insert that leaves a leaf deeper than
+    // factor * log2(size()) rebuilds the smallest too-deep subtree above
+    // it; 0 (the default) turns this off. Trees that keep a balance of
+    // their own throw std::logic_error for anything but 0.
+    virtual void setAutoRebalance(double factor);
+    // Rebuilds the tree so that keys find() returned often sit near the
+    // root; needs a HitCountNode. The counts start over afterwards.
+    void optimizeForAccess();
     void print() const;
     bool empty() const;
+    size_t size() const;
 
-    template<typename PPKey, typename PPValue>
-    friend void prettyPrintBST(BinarySearchTree<PPKey, PPValue> & tree);
+    template<typename PPKey, typename PPValue, typename PPCompare, typename PPNodeAlloc, typename PPNodeType>
+    friend void prettyPrintBST(BinarySearchTree<PPKey, PPValue, PPCompare, PPNodeAlloc, PPNodeType> & tree);
 public:
     /**
     * An internal iterator class for traversing the contents of the BST.
@@ -222,38 +509,137 @@ public:
         iterator& operator++();
 
     protected:
-        friend class BinarySearchTree<Key, Value>;
-        iterator(Node<Key,Value>* ptr);
-        Node<Key, Value> *current_;
+        friend class BinarySearchTree<Key, Value, Compare, NodeAlloc, NodeType>;
+        iterator(NodeType* ptr);
+        NodeType *current_;
     };
 
 public:
     iterator begin() const;
     iterator end() const;
+    iterator last() const;
     iterator find(const Key& key) const;
     Value& operator[](const Key& key);
     Value const & operator[](const Key& key) const;
+    Compare key_comp() const;
+
+    // Ordered lookups; each returns end() when no key qualifies.
+    iterator lower_bound(const Key& key) const; // first key >= key
+    iterator upper_bound(const Key& key) const; // first key > key
+    std::pair<iterator, iterator> equal_range(const Key& key) const;
+    iterator floor(const Key& key) const;       // last key <= key
+    iterator ceiling(const Key& key) const;     // first key >= key
+
+    // Order statistics in O(log n); need a node that counts its subtree
+    // (CountedAVLNode).
+    iterator select(size_t index) const;        // index-th smallest, from 0
+    size_t rank(const Key& key) const;          // number of keys < key
+    size_t countRange(const Key& lo, const Key& hi) const; // keys in [lo, hi]
+
+    // Combines the summaries of the items with keys in [lo, hi] in key
+    // order in O(log n); needs an AggregateAVLNode.
+    template<typename N = NodeType>
+    typename N::summary_type rangeAggregate(const Key& lo, const Key& hi) const;
+
+    // Lookups by anything Compare can order against Key; transparent Compare only.
+    template<typename K>
+    typename IfTransparent<Compare, K, iterator>::type find(const K& key) const;
+    template<typename K>
+    typename IfTransparent<Compare, K, Value&>::type operator[](const K& key);
+    template<typename K>
+    typename IfTransparent<Compare, K, Value const &>::type operator[](const K& key) const;
+
+    // The bool is true when a node was created, false when the key existed.
+    std::pair<iterator, bool> insert(const std::pair<const Key, Value>& keyValuePair); //TODO
+    std::pair<iterator, bool> insert(std::pair<const Key, Value>&& keyValuePair);
+    iterator insert(iterator hint, const std::pair<const Key, Value>& keyValuePair);
+    iterator insert(iterator hint, std::pair<const Key, Value>&& keyValuePair);
+    template<typename... Args>
+    std::pair<iterator, bool> emplace(Args&&... args);
+    template<typename... Args>
+    std::pair<iterator, bool> try_emplace(const Key& key, Args&&... args);
+    template<typename... Args>
+    std::pair<iterator, bool> try_emplace(Key&& key, Args&&... args);
+    template<typename M>
+    std::pair<iterator, bool> insert_or_assign(const Key& key, M&& obj);
+    template<typename M>
+    std::pair<iterator, bool> insert_or_assign(Key&& key, M&& obj);
 
 protected:
     // Mandatory helper functions
-    Node<Key, Value>* internalFind(const Key& k) const; // TODO
-    Node<Key, Value> *getSmallestNode() const;  // TODO
-    static Node<Key, Value>* predecessor(Node<Key, Value>* current); // TODO
+    template<typename K>
+    NodeType* internalFind(const K& k) const; // TODO
+    template<typename K>
+    NodeType* ceilingNode(const K& key, bool orEqual) const;
+    template<typename K>
+    NodeType* floorNode(const K& key, bool orEqual) const;
+    NodeType *getSmallestNode() const;  // TODO
+    NodeType *getLargestNode() const;
+    static NodeType* predecessor(NodeType* current); // TODO
     // Note:  static means these functions don't have a "this" pointer
     //        and instead just use the input argument.
 
     // Provided helper functions
-    virtual void printRoot (Node<Key, Value> *r) const;
-    virtual void nodeSwap( Node<Key,Value>* n1, Node<Key,Value>* n2) ;
+    virtual void printRoot (NodeType *r) const;
+    virtual void nodeSwap( NodeType* n1, NodeType* n2) ;
+    virtual void balanceAfterInsert(NodeType* leaf);
+    virtual void foundOnInsert(NodeType* node);
+    virtual void setBuiltBalance(NodeType* node, int balance, size_t leftCount, size_t rightCount);
 
     // Add helper functions here
-		static Node<Key, Value>* successor(Node<Key, Value>* current); // TODO
-		int calculateHeightIfBalanced(Node<Key, Value>* root, bool* unbalancedbool) const;
-		void promote(Node<Key, Value>* toPromote);
-		void postOrderTraveralClear(Node<Key, Value>* curr);
+		static NodeType* successor(NodeType* current); // TODO
+		int calculateHeightIfBalanced(NodeType* root, bool* unbalancedbool) const;
+		void promote(NodeType* toPromote);
+		size_t postOrderTraveralClear(NodeType* curr); // returns the nodes freed
+		static int subtreeHeight(NodeType* root);
+		static void collectVanEmdeBoas(NodeType* root, int levels, std::vector<NodeType*>& out);
+		template<typename A, typename B>
+		int compareKeys(const A& a, const B& b) const;
+		NodeType* findInsertSlot(const Key& key, NodeType*& parent, bool& leftChild) const;
+		NodeType* findInsertSlotNear(NodeType* hint, const Key& key, NodeType*& parent, bool& leftChild) const;
+		void attachLeaf(NodeType* parent, bool leftChild, NodeType* leaf);
+		void detachBookkeeping(NodeType* node);
+		template<typename ForwardIt>
+		NodeType* createNode(ForwardIt item, std::vector<NodeType*>& created);
+		NodeType* linkBalanced(NodeType** nodes, size_t count, int& height);
+		void relinkAll(std::vector<NodeType*>& nodes);
+		template<typename ForwardIt>
+		struct IteratorKeyLess;
+		template<typename... Args>
+		NodeType* createLeaf(NodeType* parent, bool leftChild, Args&&... args);
+		void refreshNode(NodeType* node);
+		void refreshNode(NodeType* node, std::true_type);
+		void refreshNode(NodeType* node, std::false_type);
+		void refreshPath(NodeType* node);
+		size_t countBelow(const Key& key, bool orEqual) const;
+		static iterator iteratorAt(NodeType* node);
+		static NodeType* nodeAt(const iterator& it);
+		static size_t subtreeCount(NodeType* node);
+		static size_t countNodes(NodeType* root);
+		static size_t countSmaller(NodeType* a, NodeType* b, bool& aSmaller);
+		static size_t countSmaller(NodeType* a, NodeType* b, bool& aSmaller, std::true_type);
+		static size_t countSmaller(NodeType* a, NodeType* b, bool& aSmaller, std::false_type);
+		void rebuildSubtree(NodeType* top, size_t count);
+		static void compressVine(NodeType*& vine, size_t rotations);
+		static size_t completeCount(size_t levels, size_t pos, size_t bottom);
+		static NodeType* linkWeighted(NodeType** nodes, const uint64_t* prefix, size_t count);
+		static void recordHit(NodeType* node, std::true_type);
+		static void recordHit(NodeType* node, std::false_type);
 protected:
-    Node<Key, Value>* root_;
-    // You should not need other data members
+    NodeType* root_;
+    NodeAlloc alloc_;   // hands out and reclaims every node of this tree
+    Compare comp_;
+    // insertBatch() merges instead of inserting once the batch has at
+    // least 1/MERGE_RATIO as many items as the tree
+    static const size_t MERGE_RATIO = 2;
+    // Kept current by attachLeaf(), detachBookkeeping(), nodeSwap(),
+    // compact() and clear(); rotations leave the in-order sequence alone.
+    // Operations that move whole subtrees between trees (AVLTree::split()
+    // and the set operations) set it from counts of their own.
+    size_t size_;
+    NodeType* leftmost_;
+    NodeType* rightmost_;
+    double rebalanceFactor_;   // see setAutoRebalance()
 };
 
 /*
@@ -265,8 +651,8 @@ Begin implementations for the BinarySearchTree::iterator class.
 /**
 * Explicit constructor that initializes an iterator with a given node pointer.
 */
-template<class Key, class Value>
-BinarySearchTree<Key, Value>::iterator::iterator(Node<Key,Value> *ptr)
+template<class Key, class Value, class Compare, class NodeAlloc, class NodeType>
+BinarySearchTree<Key, Value, Compare, NodeAlloc, NodeType>::iterator::iterator(NodeType *ptr)
 {
     // TODO
 		this->current_ = ptr;
@@ -276,8 +662,8 @@ BinarySearchTree<Key, Value>::iterator::iterator(Node<Key,Value> *ptr)
 /**
 * A default constructor that initializes the iterator to NULL.
 */
-template<class Key, class Value>
-BinarySearchTree<Key, Value>::iterator::iterator() 
+template<class Key, class Value, class Compare, class NodeAlloc, class NodeType>
+BinarySearchTree<Key, Value, Compare, NodeAlloc, NodeType>::iterator::iterator() 
 {
     // TODO
 		this->current_ = NULL;
@@ -287,9 +673,9 @@ BinarySearchTree<Key, Value>::iterator::iterator()
 /**
 * Provides access to the item.
 */
-template<class Key, class Value>
+template<class Key, class Value, class Compare, class NodeAlloc, class NodeType>
 std::pair<const Key,Value> &
-BinarySearchTree<Key, Value>::iterator::operator*() const
+BinarySearchTree<Key, Value, Compare, NodeAlloc, NodeType>::iterator::operator*() const
 {
     return current_->getItem();
 }
@@ -297,9 +683,9 @@ BinarySearchTree<Key, Value>::iterator::operator*() const
 /**
 * Provides access to the address of the item.
 */
-template<class Key, class Value>
+template<class Key, class Value, class Compare, class NodeAlloc, class NodeType>
 std::pair<const Key,Value> *
-BinarySearchTree<Key, Value>::iterator::operator->() const
+BinarySearchTree<Key, Value, Compare, NodeAlloc, NodeType>::iterator::operator->() const
 {
     return &(current_->getItem());
 }
@@ -308,10 +694,10 @@ BinarySearchTree<Key, Value>::iterator::operator->() const
 * Checks if 'this' iterator's internals have the same value
 * as 'rhs'
 */
-template<class Key, class Value>
+template<class Key, class Value, class Compare, class NodeAlloc, class NodeType>
 bool
-BinarySearchTree<Key, Value>::iterator::operator==(
-    const BinarySearchTree<Key, Value>::iterator& rhs) const
+BinarySearchTree<Key, Value, Compare, NodeAlloc, NodeType>::iterator::operator==(
+    const BinarySearchTree<Key, Value, Compare, NodeAlloc, NodeType>::iterator& rhs) const
 {
     // TODO
 		return(this->current_ == (&rhs)->current_);
@@ -321,10 +707,10 @@ BinarySearchTree<Key, Value>::iterator::operator==(
 * Checks if 'this' iterator's internals have a different value
 * as 'rhs'
 */
-template<class Key, class Value>
+template<class Key, class Value, class Compare, class NodeAlloc, class NodeType>
 bool
-BinarySearchTree<Key, Value>::iterator::operator!=(
-    const BinarySearchTree<Key, Value>::iterator& rhs) const
+BinarySearchTree<Key, Value, Compare, NodeAlloc, NodeType>::iterator::operator!=(
+    const BinarySearchTree<Key, Value, Compare, NodeAlloc, NodeType>::iterator& rhs) const
 {
     // TODO
 		return(this->current_ != (&rhs)->current_);
@@ -334,9 +720,9 @@ BinarySearchTree<Key, Value>::iterator::operator!=(
 /**
 * Advances the iterator's location using an in-order sequencing
 */
-template<class Key, class Value>
-typename BinarySearchTree<Key, Value>::iterator&
-BinarySearchTree<Key, Value>::iterator::operator++()
+template<class Key, class Value, class Compare, class NodeAlloc, class NodeType>
+typename BinarySearchTree<Key, Value, Compare, NodeAlloc, NodeType>::iterator&
+BinarySearchTree<Key, Value, Compare, NodeAlloc, NodeType>::iterator::operator++()
 {
     // TODO
 		this->current_ = successor(this->current_);
@@ -360,15 +746,50 @@ Begin implementations for the BinarySearchTree class.
 /**
 * Default constructor for a BinarySearchTree, which sets the root to NULL.
 */
-template<class Key, class Value>
-BinarySearchTree<Key, Value>::BinarySearchTree() 
+template<class Key, class Value, class Compare, class NodeAlloc, class NodeType>
+BinarySearchTree<Key, Value, Compare, NodeAlloc, NodeType>::BinarySearchTree() 
 {
     // TODO
 		this->root_ = NULL;
+		this->size_ = 0;
+		this->leftmost_ = NULL;
+		this->rightmost_ = NULL;
+		this->rebalanceFactor_ = 0;
+}
+
+/**
+* Constructs an empty tree ordered by comp.
+*/
+template<class Key, class Value, class Compare, class NodeAlloc, class NodeType>
+BinarySearchTree<Key, Value, Compare, NodeAlloc, NodeType>::BinarySearchTree(const Compare& comp) :
+    root_(NULL),
+    comp_(comp),
+    size_(0),
+    leftmost_(NULL),
+    rightmost_(NULL),
+    rebalanceFactor_(0)
+{
+
+}
+
+/**
+* Constructs a tree holding [first, last); see assign().
+*/
+template<class Key, class Value, class Compare, class NodeAlloc, class NodeType>
+template<typename ForwardIt>
+BinarySearchTree<Key, Value, Compare, NodeAlloc, NodeType>::BinarySearchTree(ForwardIt first, ForwardIt last, const Compare& comp) :
+    root_(NULL),
+    comp_(comp),
+    size_(0),
+    leftmost_(NULL),
+    rightmost_(NULL),
+    rebalanceFactor_(0)
+{
+    assign(first, last);
 }
 
-template<typename Key, typename Value>
-BinarySearchTree<Key, Value>::~BinarySearchTree()
+template<typename Key, typename Value, typename Compare, typename NodeAlloc, typename NodeType>
+BinarySearchTree<Key, Value, Compare, NodeAlloc, NodeType>::~BinarySearchTree()
 {
     // TODO
 		this->clear();
@@ -378,14 +799,23 @@ BinarySearchTree<Key, Value>::~BinarySearchTree()
 /**
  * Returns true if tree is empty
 */
-template<class Key, class Value>
-bool BinarySearchTree<Key, Value>::empty() const
+template<class Key, class Value, class Compare, class NodeAlloc, class NodeType>
+bool BinarySearchTree<Key, Value, Compare, NodeAlloc, NodeType>::empty() const
 {
     return root_ == NULL;
 }
 
-template<typename Key, typename Value>
-void BinarySearchTree<Key, Value>::print() const
+/**
+ * Returns the number of items in constant time
+*/
+template<class Key, class Value, class Compare, class NodeAlloc, class NodeType>
+size_t BinarySearchTree<Key, Value, Compare, NodeAlloc, NodeType>::size() const
+{
+    return size_;
+}
+
+template<typename Key, typename Value, typename Compare, typename NodeAlloc, typename NodeType>
+void BinarySearchTree<Key, Value, Compare, NodeAlloc, NodeType>::print() const
 {
     printRoot(root_);
 }
@@ -393,35 +823,47 @@ void BinarySearchTree<Key, Value>::print() const
 /**
 * Returns an iterator to the "smallest" item in the tree
 */
-template<class Key, class Value>
-typename BinarySearchTree<Key, Value>::iterator
-BinarySearchTree<Key, Value>::begin() const
+template<class Key, class Value, class Compare, class NodeAlloc, class NodeType>
+typename BinarySearchTree<Key, Value, Compare, NodeAlloc, NodeType>::iterator
+BinarySearchTree<Key, Value, Compare, NodeAlloc, NodeType>::begin() const
 {
-    BinarySearchTree<Key, Value>::iterator begin(getSmallestNode());
+    BinarySearchTree<Key, Value, Compare, NodeAlloc, NodeType>::iterator begin(getSmallestNode());
     return begin;
 }
 
 /**
 * Returns an iterator whose value means INVALID
 */
-template<class Key, class Value>
-typename BinarySearchTree<Key, Value>::iterator
-BinarySearchTree<Key, Value>::end() const
+template<class Key, class Value, class Compare, class NodeAlloc, class NodeType>
+typename BinarySearchTree<Key, Value, Compare, NodeAlloc, NodeType>::iterator
+BinarySearchTree<Key, Value, Compare, NodeAlloc, NodeType>::end() const
 {
-    BinarySearchTree<Key, Value>::iterator end(NULL);
+    BinarySearchTree<Key, Value, Compare, NodeAlloc, NodeType>::iterator end(NULL);
     return end;
 }
 
+/**
+* Returns an iterator to the "largest" item in the tree,
+* or end() if the tree is empty
+*/
+template<class Key, class Value, class Compare, class NodeAlloc, class NodeType>
+typename BinarySearchTree<Key, Value, Compare, NodeAlloc, NodeType>::iterator
+BinarySearchTree<Key, Value, Compare, NodeAlloc, NodeType>::last() const
+{
+    return iterator(getLargestNode());
+}
+
 /**
 * Returns an iterator to the item with the given key, k
 * or the end iterator if k does not exist in the tree
 */
-template<class Key, class Value>
-typename BinarySearchTree<Key, Value>::iterator
-BinarySearchTree<Key, Value>::find(const Key & k) const
+template<class Key, class Value, class Compare, class NodeAlloc, class NodeType>
+typename BinarySearchTree<Key, Value, Compare, NodeAlloc, NodeType>::iterator
+BinarySearchTree<Key, Value, Compare, NodeAlloc, NodeType>::find(const Key & k) const
 {
-    Node<Key, Value> *curr = internalFind(k);
-    BinarySearchTree<Key, Value>::iterator it(curr);
+    NodeType *curr = internalFind(k);
+    if(curr != NULL) recordHit(curr, CountsHits<NodeType>());
+    BinarySearchTree<Key, Value, Compare, NodeAlloc, NodeType>::iterator it(curr);
     return it;
 }
 
@@ -429,160 +871,780 @@ BinarySearchTree<Key, Value>::find(const Key & k) const
  * @precondition The key exists in the map
  * Returns the value associated with the key
  */
-template<class Key, class Value>
-Value& BinarySearchTree<Key, Value>::operator[](const Key& key)
+template<class Key, class Value, class Compare, class NodeAlloc, class NodeType>
+Value& BinarySearchTree<Key, Value, Compare, NodeAlloc, NodeType>::operator[](const Key& key)
 {
-    Node<Key, Value> *curr = internalFind(key);
+    NodeType *curr = internalFind(key);
     if(curr == NULL) throw std::out_of_range("Invalid key");
     return curr->getValue();
 }
-template<class Key, class Value>
-Value const & BinarySearchTree<Key, Value>::operator[](const Key& key) const
+template<class Key, class Value, class Compare, class NodeAlloc, class NodeType>
+Value const & BinarySearchTree<Key, Value, Compare, NodeAlloc, NodeType>::operator[](const Key& key) const
 {
-    Node<Key, Value> *curr = internalFind(key);
+    NodeType *curr = internalFind(key);
     if(curr == NULL) throw std::out_of_range("Invalid key");
     return curr->getValue();
 }
 
 /**
-* An insert method to insert into a Binary Search Tree.
-* The tree will not remain balanced when inserting.
-* Recall: If key is already in the tree, you should 
-* overwrite the current value with the updated value.
+* Returns a copy of the comparator that orders the keys.
 */
-/*
-  Youre writing while loop - go until you find empty 
-  spot to insert node OR find a key that’s exact same val, 
-  then update key’s value - shouldn’t be doing more than 
-  log(n) runs 
+template<class Key, class Value, class Compare, class NodeAlloc, class NodeType>
+Compare BinarySearchTree<Key, Value, Compare, NodeAlloc, NodeType>::key_comp() const
+{
+    return comp_;
+}
+
+/**
+* Returns an iterator to the first item whose key is not less than key,
+* so a range scan can start there instead of at begin().
 */
+template<class Key, class Value, class Compare, class NodeAlloc, class NodeType>
+typename BinarySearchTree<Key, Value, Compare, NodeAlloc, NodeType>::iterator
+BinarySearchTree<Key, Value, Compare, NodeAlloc, NodeType>::lower_bound(const Key& key) const
+{
+    return iterator(ceilingNode(key, true));
+}
 
-template<class Key, class Value>
-void BinarySearchTree<Key, Value>::insert(const std::pair<const Key, Value> &keyValuePair)
+/**
+* Returns an iterator to the first item whose key is greater than key.
+*/
+template<class Key, class Value, class Compare, class NodeAlloc, class NodeType>
+typename BinarySearchTree<Key, Value, Compare, NodeAlloc, NodeType>::iterator
+BinarySearchTree<Key, Value, Compare, NodeAlloc, NodeType>::upper_bound(const Key& key) const
 {
-  // TODO
-	if (this->root_ == NULL)
-	{
-		Node<Key, Value>* insertroot = new Node<Key, Value>(keyValuePair.first, keyValuePair.second, NULL);
-		this->root_ = insertroot;
-		return;
-	}
-  Node<Key, Value>* current = this->root_;
-	Node<Key, Value>* currentcopy = this->root_;
-	bool insertedAlready = 0;
-	
-  while (current != NULL)
-  {
-      if (current->getKey() > keyValuePair.first)
-      {
-					currentcopy = current;
-					current = current->getLeft();
-      }
-      else if (current->getKey() < keyValuePair.first)
-      {
-					currentcopy = current;
-          current = current->getRight();
-      }
-      else // (current->getKey == (&KeyValuePair)->getKey)
-      {
-          current->setValue(keyValuePair.second);
-					insertedAlready = 1;
-					break;
-      }
-  }
-	if (!insertedAlready) // create a new leaf node with currentcopy as the parent 
-	{
-		Node<Key, Value>* insertleaf = new Node<Key, Value>(keyValuePair.first, keyValuePair.second, currentcopy);
-		if (insertleaf->getKey() > currentcopy->getKey()) // insert right leaf
-		{
-			currentcopy->setRight(insertleaf);
-		}
-		else // insert left leaf
-		{
-			currentcopy->setLeft(insertleaf);
-		}
-	}
+    return iterator(ceilingNode(key, false));
 }
 
+/**
+* Returns [lower_bound(key), upper_bound(key)) with a single descent.
+* Keys are unique, so the range holds at most one item.
+*/
+template<class Key, class Value, class Compare, class NodeAlloc, class NodeType>
+std::pair<typename BinarySearchTree<Key, Value, Compare, NodeAlloc, NodeType>::iterator,
+          typename BinarySearchTree<Key, Value, Compare, NodeAlloc, NodeType>::iterator>
+BinarySearchTree<Key, Value, Compare, NodeAlloc, NodeType>::equal_range(const Key& key) const
+{
+    NodeType* first = ceilingNode(key, true);
+    NodeType* last = first;
+    if(first != NULL && compareKeys(key, first->getKey()) == 0)
+    {
+        last = successor(first);
+    }
+    return std::make_pair(iterator(first), iterator(last));
+}
 
 /**
-* A remove method to remove a specific key from a Binary Search Tree.
-* Recall: The writeup specifies that if a node has 2 children you
-* should swap with the predecessor and then remove.
+* Returns an iterator to the item with the largest key not greater than
+* key, or end() if every key is greater.
 */
-template<typename Key, typename Value>
-void BinarySearchTree<Key, Value>::remove(const Key& key)
+template<class Key, class Value, class Compare, class NodeAlloc, class NodeType>
+typename BinarySearchTree<Key, Value, Compare, NodeAlloc, NodeType>::iterator
+BinarySearchTree<Key, Value, Compare, NodeAlloc, NodeType>::floor(const Key& key) const
 {
-    // TODO
-		Node<Key, Value>* nodeToRemove = internalFind(key);
-		if (nodeToRemove == NULL) // node not in tree 
-		{
-			return;
-		}
-        // 2 children
-		if (nodeToRemove->getLeft() != NULL && nodeToRemove->getRight() != NULL)
-		{
-            
-			Node<Key, Value>* predec = predecessor(nodeToRemove); 
-			nodeSwap(nodeToRemove, predec); // this will make predecessor the root if nodeToRemove was the root
-		}
-		// no children
-		if (nodeToRemove->getLeft() == NULL && nodeToRemove->getRight() == NULL)
-		{
-			if (nodeToRemove == this->root_) // no children, and it's the root - must be the only node in tree 
-			{
-			    this->clear();
-					return;
-			}
-			else if (nodeToRemove->getParent()->getLeft() == nodeToRemove)
-			{
-				(nodeToRemove->getParent())->setLeft(NULL);	
-			}
-			else if (nodeToRemove->getParent()->getRight() == nodeToRemove)
-			{
-				(nodeToRemove->getParent())->setRight(NULL);	
-			}
-			delete nodeToRemove;
-			nodeToRemove = NULL; 
-		}
-		// 1 child (left)
-		else if (nodeToRemove->getLeft() != NULL && nodeToRemove->getRight() == NULL)
-		{
-			promote(nodeToRemove->getLeft());
-			delete nodeToRemove;
-			nodeToRemove = NULL;
-		}
-		// 1 child (right)
-		else if (nodeToRemove->getLeft() == NULL && nodeToRemove->getRight() != NULL)
-		{
-			promote(nodeToRemove->getRight());
-			delete nodeToRemove;
-			nodeToRemove = NULL;
-		}
+    return iterator(floorNode(key, true));
 }
- 
- 
- //4 is on the right of the node were removing BUT its on the left of the grandparent node 
 
+/**
+* Returns an iterator to the item with the smallest key not less than
+* key, or end() if every key is less. Same as lower_bound().
+*/
+template<class Key, class Value, class Compare, class NodeAlloc, class NodeType>
+typename BinarySearchTree<Key, Value, Compare, NodeAlloc, NodeType>::iterator
+BinarySearchTree<Key, Value, Compare, NodeAlloc, NodeType>::ceiling(const Key& key) const
+{
+    return iterator(ceilingNode(key, true));
+}
 
-// promote
-// set grandparent of node toPromote to be the parent of toPromote
-// set the child of the old grandparent of toPromote to be toPromote instead of toPromote's parent 
-template<typename Key, typename Value>
-void BinarySearchTree<Key, Value>::promote(Node<Key, Value>* toPromote)
+/**
+* Returns an iterator to the item at position index in key order (0 is
+* the smallest), or end() if index >= size().
+*/
+template<class Key, class Value, class Compare, class NodeAlloc, class NodeType>
+typename BinarySearchTree<Key, Value, Compare, NodeAlloc, NodeType>::iterator
+BinarySearchTree<Key, Value, Compare, NodeAlloc, NodeType>::select(size_t index) const
 {
-	if (toPromote->getParent() == this->root_) // is nodeToRemove is the root node, need to make nodetoPromote the new root_
-	{
-		this->root_ = toPromote;
-	}
-	Node<Key, Value>* grandparent = (toPromote->getParent())->getParent(); 
-	if (grandparent != NULL) // if we didnt just make it a root_
-	{
-		if (toPromote->getParent() == grandparent->getLeft())
-		{
-			grandparent->setLeft(toPromote); 
-		}
-		else if (toPromote->getParent() == grandparent->getRight())
+    NodeType* current = this->root_;
+    while(current != NULL)
+    {
+        size_t leftCount = subtreeCount(current->getLeft());
+        if(index < leftCount)
+        {
+            current = current->getLeft();
+        }
+        else if(index == leftCount)
+        {
+            break;
+        }
+        else
+        {
+            index -= leftCount + 1;
+            current = current->getRight();
+        }
+    }
+    return iterator(current);
+}
+
+/**
+* Returns the number of keys less than key, which is the position key
+* has or would have in key order.
+*/
+template<class Key, class Value, class Compare, class NodeAlloc, class NodeType>
+size_t BinarySearchTree<Key, Value, Compare, NodeAlloc, NodeType>::rank(const Key& key) const
+{
+    return countBelow(key, false);
+}
+
+/**
+* Returns the number of keys k with lo <= k <= hi.
+*/
+template<class Key, class Value, class Compare, class NodeAlloc, class NodeType>
+size_t BinarySearchTree<Key, Value, Compare, NodeAlloc, NodeType>::countRange(const Key& lo, const Key& hi) const
+{
+    if(compareKeys(lo, hi) > 0)
+    {
+        return 0;
+    }
+    return countBelow(hi, true) - countBelow(lo, false);
+}
+
+/**
+* Walks down to the highest node inside [lo, hi], then along the paths
+* to lo and to hi below it. Every subtree hanging inside the range is
+* taken whole from its cached summary, so at most two paths are visited.
+* The combine order follows key order, so the monoid needs to be
+* associative but not commutative.
+*/
+template<class Key, class Value, class Compare, class NodeAlloc, class NodeType>
+template<typename N>
+typename N::summary_type
+BinarySearchTree<Key, Value, Compare, NodeAlloc, NodeType>::rangeAggregate(const Key& lo, const Key& hi) const
+{
+    typedef typename N::monoid_type Monoid;
+    NodeType* top = this->root_;
+    while(top != NULL)
+    {
+        if(compareKeys(top->getKey(), lo) < 0)
+        {
+            top = top->getRight();
+        }
+        else if(compareKeys(hi, top->getKey()) < 0)
+        {
+            top = top->getLeft();
+        }
+        else
+        {
+            break;
+        }
+    }
+    if(top == NULL)
+    {
+        return Monoid::identity();
+    }
+
+    // left of top, every node >= lo is in range along with its right subtree
+    typename N::summary_type below = Monoid::identity();
+    for(NodeType* n = top->getLeft(); n != NULL; )
+    {
+        if(compareKeys(n->getKey(), lo) < 0)
+        {
+            n = n->getRight();
+            continue;
+        }
+        typename N::summary_type part = Monoid::of(n->getKey(), n->getValue());
+        if(n->getRight() != NULL) part = Monoid::combine(part, n->getRight()->getSummary());
+        below = Monoid::combine(part, below);
+        n = n->getLeft();
+    }
+
+    // right of top, every node <= hi is in range along with its left subtree
+    typename N::summary_type above = Monoid::identity();
+    for(NodeType* n = top->getRight(); n != NULL; )
+    {
+        if(compareKeys(hi, n->getKey()) < 0)
+        {
+            n = n->getLeft();
+            continue;
+        }
+        typename N::summary_type part = Monoid::of(n->getKey(), n->getValue());
+        if(n->getLeft() != NULL) part = Monoid::combine(n->getLeft()->getSummary(), part);
+        above = Monoid::combine(above, part);
+        n = n->getRight();
+    }
+    return Monoid::combine(below, Monoid::combine(Monoid::of(top->getKey(), top->getValue()), above));
+}
+
+/**
+* find() for a probe of another type, e.g. a const char* against
+* std::string keys. No Key is constructed.
+*/
+template<class Key, class Value, class Compare, class NodeAlloc, class NodeType>
+template<typename K>
+typename IfTransparent<Compare, K, typename BinarySearchTree<Key, Value, Compare, NodeAlloc, NodeType>::iterator>::type
+BinarySearchTree<Key, Value, Compare, NodeAlloc, NodeType>::find(const K& k) const
+{
+    NodeType *curr = internalFind(k);
+    if(curr != NULL) recordHit(curr, CountsHits<NodeType>());
+    return iterator(curr);
+}
+
+template<class Key, class Value, class Compare, class NodeAlloc, class NodeType>
+template<typename K>
+typename IfTransparent<Compare, K, Value&>::type
+BinarySearchTree<Key, Value, Compare, NodeAlloc, NodeType>::operator[](const K& key)
+{
+    NodeType *curr = internalFind(key);
+    if(curr == NULL) throw std::out_of_range("Invalid key");
+    return curr->getValue();
+}
+
+template<class Key, class Value, class Compare, class NodeAlloc, class NodeType>
+template<typename K>
+typename IfTransparent<Compare, K, Value const &>::type
+BinarySearchTree<Key, Value, Compare, NodeAlloc, NodeType>::operator[](const K& key) const
+{
+    NodeType *curr = internalFind(key);
+    if(curr == NULL) throw std::out_of_range("Invalid key");
+    return curr->getValue();
+}
+
+/**
+* An insert method to insert into a Binary Search Tree.
+* The tree will not remain balanced when inserting.
+* Recall: If key is already in the tree, you should 
+* overwrite the current value with the updated value.
+*/
+template<class Key, class Value, class Compare, class NodeAlloc, class NodeType>
+std::pair<typename BinarySearchTree<Key, Value, Compare, NodeAlloc, NodeType>::iterator, bool>
+BinarySearchTree<Key, Value, Compare, NodeAlloc, NodeType>::insert(const std::pair<const Key, Value> &keyValuePair)
+{
+	NodeType* parent;
+	bool leftChild;
+	NodeType* current = findInsertSlot(keyValuePair.first, parent, leftChild);
+	if (current != NULL)
+	{
+		current->setValue(keyValuePair.second);
+		refreshPath(current);
+		foundOnInsert(current);
+		return std::make_pair(iterator(current), false);
+	}
+	return std::make_pair(iterator(createLeaf(parent, leftChild, keyValuePair)), true);
+}
+
+/**
+* As above, but the item is moved into the new node, or only the value
+* is moved over the existing one.
+*/
+template<class Key, class Value, class Compare, class NodeAlloc, class NodeType>
+std::pair<typename BinarySearchTree<Key, Value, Compare, NodeAlloc, NodeType>::iterator, bool>
+BinarySearchTree<Key, Value, Compare, NodeAlloc, NodeType>::insert(std::pair<const Key, Value>&& keyValuePair)
+{
+	NodeType* parent;
+	bool leftChild;
+	NodeType* current = findInsertSlot(keyValuePair.first, parent, leftChild);
+	if (current != NULL)
+	{
+		current->getValue() = std::move(keyValuePair.second);
+		refreshPath(current);
+		foundOnInsert(current);
+		return std::make_pair(iterator(current), false);
+	}
+	return std::make_pair(iterator(createLeaf(parent, leftChild, std::move(keyValuePair))), true);
+}
+
+/**
+* Inserts with a hint: when the key belongs right next to hint (before
+* or after it), the new node is linked there without a search from the
+* root. Passing end() as the hint appends after the largest key in
+* constant time. A wrong hint costs only a few extra comparisons.
+* Returns an iterator to the item with the key; an existing value is
+* overwritten, as with insert().
+*/
+template<class Key, class Value, class Compare, class NodeAlloc, class NodeType>
+typename BinarySearchTree<Key, Value, Compare, NodeAlloc, NodeType>::iterator
+BinarySearchTree<Key, Value, Compare, NodeAlloc, NodeType>::insert(iterator hint, const std::pair<const Key, Value> &keyValuePair)
+{
+	NodeType* parent;
+	bool leftChild;
+	NodeType* current = findInsertSlotNear(hint.current_, keyValuePair.first, parent, leftChild);
+	if (current != NULL)
+	{
+		current->setValue(keyValuePair.second);
+		refreshPath(current);
+		foundOnInsert(current);
+		return iterator(current);
+	}
+	return iterator(createLeaf(parent, leftChild, keyValuePair));
+}
+
+template<class Key, class Value, class Compare, class NodeAlloc, class NodeType>
+typename BinarySearchTree<Key, Value, Compare, NodeAlloc, NodeType>::iterator
+BinarySearchTree<Key, Value, Compare, NodeAlloc, NodeType>::insert(iterator hint, std::pair<const Key, Value>&& keyValuePair)
+{
+	NodeType* parent;
+	bool leftChild;
+	NodeType* current = findInsertSlotNear(hint.current_, keyValuePair.first, parent, leftChild);
+	if (current != NULL)
+	{
+		current->getValue() = std::move(keyValuePair.second);
+		refreshPath(current);
+		foundOnInsert(current);
+		return iterator(current);
+	}
+	return iterator(createLeaf(parent, leftChild, std::move(keyValuePair)));
+}
+
+/**
+* Builds the item from args inside a new node, then links it in. Like
+* std::map::emplace, an existing key is left untouched and the new node
+* is discarded.
+*/
+template<class Key, class Value, class Compare, class NodeAlloc, class NodeType>
+template<typename... Args>
+std::pair<typename BinarySearchTree<Key, Value, Compare, NodeAlloc, NodeType>::iterator, bool>
+BinarySearchTree<Key, Value, Compare, NodeAlloc, NodeType>::emplace(Args&&... args)
+{
+	NodeType* leaf = this->alloc_.template create<NodeType>(EmplaceTag(), nullptr, std::forward<Args>(args)...);
+	NodeType* parent;
+	bool leftChild;
+	NodeType* current;
+	try
+	{
+		current = findInsertSlot(leaf->getKey(), parent, leftChild);
+	}
+	catch (...)
+	{
+		this->alloc_.destroy(leaf);
+		throw;
+	}
+	if (current != NULL)
+	{
+		this->alloc_.destroy(leaf);
+		foundOnInsert(current);
+		return std::make_pair(iterator(current), false);
+	}
+	leaf->setParent(parent);
+	attachLeaf(parent, leftChild, leaf);
+	return std::make_pair(iterator(leaf), true);
+}
+
+/**
+* Constructs the value from args only if key is absent; otherwise
+* nothing is constructed and the existing value is left alone.
+*/
+template<class Key, class Value, class Compare, class NodeAlloc, class NodeType>
+template<typename... Args>
+std::pair<typename BinarySearchTree<Key, Value, Compare, NodeAlloc, NodeType>::iterator, bool>
+BinarySearchTree<Key, Value, Compare, NodeAlloc, NodeType>::try_emplace(const Key& key, Args&&... args)
+{
+	NodeType* parent;
+	bool leftChild;
+	NodeType* current = findInsertSlot(key, parent, leftChild);
+	if (current != NULL)
+	{
+		foundOnInsert(current);
+		return std::make_pair(iterator(current), false);
+	}
+	return std::make_pair(iterator(createLeaf(parent, leftChild, std::piecewise_construct,
+		std::forward_as_tuple(key), std::forward_as_tuple(std::forward<Args>(args)...))), true);
+}
+
+template<class Key, class Value, class Compare, class NodeAlloc, class NodeType>
+template<typename... Args>
+std::pair<typename BinarySearchTree<Key, Value, Compare, NodeAlloc, NodeType>::iterator, bool>
+BinarySearchTree<Key, Value, Compare, NodeAlloc, NodeType>::try_emplace(Key&& key, Args&&... args)
+{
+	NodeType* parent;
+	bool leftChild;
+	NodeType* current = findInsertSlot(key, parent, leftChild);
+	if (current != NULL)
+	{
+		foundOnInsert(current);
+		return std::make_pair(iterator(current), false);
+	}
+	return std::make_pair(iterator(createLeaf(parent, leftChild, std::piecewise_construct,
+		std::forward_as_tuple(std::move(key)), std::forward_as_tuple(std::forward<Args>(args)...))), true);
+}
+
+/**
+* Assigns obj to the value of key, inserting key first if it is absent.
+*/
+template<class Key, class Value, class Compare, class NodeAlloc, class NodeType>
+template<typename M>
+std::pair<typename BinarySearchTree<Key, Value, Compare, NodeAlloc, NodeType>::iterator, bool>
+BinarySearchTree<Key, Value, Compare, NodeAlloc, NodeType>::insert_or_assign(const Key& key, M&& obj)
+{
+	NodeType* parent;
+	bool leftChild;
+	NodeType* current = findInsertSlot(key, parent, leftChild);
+	if (current != NULL)
+	{
+		current->getValue() = std::forward<M>(obj);
+		refreshPath(current);
+		foundOnInsert(current);
+		return std::make_pair(iterator(current), false);
+	}
+	return std::make_pair(iterator(createLeaf(parent, leftChild, key, std::forward<M>(obj))), true);
+}
+
+template<class Key, class Value, class Compare, class NodeAlloc, class NodeType>
+template<typename M>
+std::pair<typename BinarySearchTree<Key, Value, Compare, NodeAlloc, NodeType>::iterator, bool>
+BinarySearchTree<Key, Value, Compare, NodeAlloc, NodeType>::insert_or_assign(Key&& key, M&& obj)
+{
+	NodeType* parent;
+	bool leftChild;
+	NodeType* current = findInsertSlot(key, parent, leftChild);
+	if (current != NULL)
+	{
+		current->getValue() = std::forward<M>(obj);
+		refreshPath(current);
+		foundOnInsert(current);
+		return std::make_pair(iterator(current), false);
+	}
+	return std::make_pair(iterator(createLeaf(parent, leftChild, std::move(key), std::forward<M>(obj))), true);
+}
+
+/*
+  Youre writing while loop - go until you find empty 
+  spot to insert node OR find a key that’s exact same val, 
+  then update key’s value - shouldn’t be doing more than 
+  log(n) runs 
+*/
+
+/**
+* Returns the node holding key, or NULL after setting parent to the node
+* a new leaf for key would hang from (NULL for an empty tree) and
+* leftChild to the side it would hang on.
+* A key past the largest one, as with increasing timestamps, is placed
+* after one comparison instead of a walk down the right spine.
+*/
+template<class Key, class Value, class Compare, class NodeAlloc, class NodeType>
+NodeType* BinarySearchTree<Key, Value, Compare, NodeAlloc, NodeType>::findInsertSlot(const Key& key, NodeType*& parent, bool& leftChild) const
+{
+	parent = NULL;
+	leftChild = false;
+	if (this->rightmost_ != NULL && compareKeys(key, this->rightmost_->getKey()) > 0)
+	{
+		parent = this->rightmost_;
+		return NULL;
+	}
+	NodeType* current = this->root_;
+	while (current != NULL)
+	{
+		int order = compareKeys(key, current->getKey());
+		if (order == 0)
+		{
+			return current;
+		}
+		parent = current;
+		leftChild = order < 0;
+		current = leftChild ? current->getLeft() : current->getRight();
+	}
+	return NULL;
+}
+
+/**
+* findInsertSlot() starting from hint (NULL for end()). The slot is taken
+* next to hint when key falls between hint and its predecessor or its
+* successor; otherwise the search starts over from the root.
+*/
+template<class Key, class Value, class Compare, class NodeAlloc, class NodeType>
+NodeType* BinarySearchTree<Key, Value, Compare, NodeAlloc, NodeType>::findInsertSlotNear(NodeType* hint, const Key& key, NodeType*& parent, bool& leftChild) const
+{
+	if (hint == NULL)
+	{
+		// findInsertSlot() already checks past the largest key first
+		return findInsertSlot(key, parent, leftChild);
+	}
+	int order = compareKeys(key, hint->getKey());
+	if (order == 0)
+	{
+		return hint;
+	}
+	if (order < 0)
+	{
+		NodeType* before = hint == this->leftmost_ ? NULL : predecessor(hint);
+		if (before == NULL || (order = compareKeys(key, before->getKey())) > 0)
+		{
+			// between before and hint: under hint if it has room, else under before
+			parent = hint->getLeft() == NULL ? hint : before;
+			leftChild = hint->getLeft() == NULL;
+			return NULL;
+		}
+		if (order == 0)
+		{
+			return before;
+		}
+	}
+	else
+	{
+		NodeType* after = hint == this->rightmost_ ? NULL : successor(hint);
+		if (after == NULL || (order = compareKeys(key, after->getKey())) < 0)
+		{
+			parent = hint->getRight() == NULL ? hint : after;
+			leftChild = hint->getRight() != NULL;
+			return NULL;
+		}
+		if (order == 0)
+		{
+			return after;
+		}
+	}
+	return findInsertSlot(key, parent, leftChild);
+}
+
+/**
+* Orders a against b with one KeyOrder<Compare>::compare() call.
+*/
+template<class Key, class Value, class Compare, class NodeAlloc, class NodeType>
+template<typename A, typename B>
+int BinarySearchTree<Key, Value, Compare, NodeAlloc, NodeType>::compareKeys(const A& a, const B& b) const
+{
+	return KeyOrder<Compare>::compare(this->comp_, a, b);
+}
+
+/**
+* Creates a node from args under parent, on the side found by
+* findInsertSlot(), and links it into the tree.
+*/
+template<class Key, class Value, class Compare, class NodeAlloc, class NodeType>
+template<typename... Args>
+NodeType* BinarySearchTree<Key, Value, Compare, NodeAlloc, NodeType>::createLeaf(NodeType* parent, bool leftChild, Args&&... args)
+{
+	NodeType* leaf = this->alloc_.template create<NodeType>(EmplaceTag(), parent, std::forward<Args>(args)...);
+	attachLeaf(parent, leftChild, leaf);
+	return leaf;
+}
+
+/**
+* Hangs leaf, whose parent link is already set, under parent (or makes it
+* the root) and lets the derived tree rebalance.
+*/
+template<class Key, class Value, class Compare, class NodeAlloc, class NodeType>
+void BinarySearchTree<Key, Value, Compare, NodeAlloc, NodeType>::attachLeaf(NodeType* parent, bool leftChild, NodeType* leaf)
+{
+	if (parent == NULL)
+	{
+		this->root_ = leaf;
+		this->leftmost_ = leaf;
+		this->rightmost_ = leaf;
+	}
+	else if (leftChild)
+	{
+		parent->setLeft(leaf);
+		if (parent == this->leftmost_) this->leftmost_ = leaf;
+	}
+	else
+	{
+		parent->setRight(leaf);
+		if (parent == this->rightmost_) this->rightmost_ = leaf;
+	}
+	++this->size_;
+	refreshPath(parent);
+	balanceAfterInsert(leaf);
+}
+
+/**
+* Recomputes the subtree summary of an augmented node (see IsAugmented).
+*/
+template<class Key, class Value, class Compare, class NodeAlloc, class NodeType>
+void BinarySearchTree<Key, Value, Compare, NodeAlloc, NodeType>::refreshNode(NodeType* node)
+{
+	refreshNode(node, IsAugmented<NodeType>());
+}
+
+template<class Key, class Value, class Compare, class NodeAlloc, class NodeType>
+void BinarySearchTree<Key, Value, Compare, NodeAlloc, NodeType>::refreshNode(NodeType* node, std::true_type)
+{
+	node->refresh();
+}
+
+template<class Key, class Value, class Compare, class NodeAlloc, class NodeType>
+void BinarySearchTree<Key, Value, Compare, NodeAlloc, NodeType>::refreshNode(NodeType* node, std::false_type)
+{
+}
+
+/**
+* Refreshes node and every ancestor after a leaf is linked in or a node
+* unlinked below node. Summaries left stale by nodeSwap() are fixed too:
+* remove() swaps a node with its predecessor, and the predecessor's new
+* place is an ancestor of the node then unlinked. Does nothing for nodes
+* that are not augmented.
+*/
+template<class Key, class Value, class Compare, class NodeAlloc, class NodeType>
+void BinarySearchTree<Key, Value, Compare, NodeAlloc, NodeType>::refreshPath(NodeType* node)
+{
+	if (!IsAugmented<NodeType>::value)
+	{
+		return;
+	}
+	for (; node != NULL; node = node->getParent())
+	{
+		refreshNode(node);
+	}
+}
+
+/**
+* Updates the count and the cached extremes for node, which has at most
+* one child and is about to be unlinked and destroyed.
+*/
+template<class Key, class Value, class Compare, class NodeAlloc, class NodeType>
+void BinarySearchTree<Key, Value, Compare, NodeAlloc, NodeType>::detachBookkeeping(NodeType* node)
+{
+	if (node == this->leftmost_)
+	{
+		this->leftmost_ = successor(node);
+	}
+	if (node == this->rightmost_)
+	{
+		this->rightmost_ = predecessor(node);
+	}
+	--this->size_;
+}
+
+/**
+* Called after every new leaf is linked in. A plain BST does not rebalance
+* unless setAutoRebalance() is on. Then a leaf deeper than the limit has
+* an ancestor whose subtree is too deep for its own size (the root, at
+* worst); the lowest one is rebuilt, as in a scapegoat tree. Its size is
+* counted on the way up, one sibling subtree at a time, which the rebuild
+* pays for.
+*/
+template<class Key, class Value, class Compare, class NodeAlloc, class NodeType>
+void BinarySearchTree<Key, Value, Compare, NodeAlloc, NodeType>::balanceAfterInsert(NodeType* leaf)
+{
+	if (this->rebalanceFactor_ == 0)
+	{
+		return;
+	}
+	int depth = 0;
+	for (NodeType* n = leaf->getParent(); n != NULL; n = n->getParent())
+	{
+		++depth;
+	}
+	if (depth <= this->rebalanceFactor_ * std::log2(static_cast<double>(this->size())))
+	{
+		return;
+	}
+	NodeType* child = leaf;
+	size_t count = 1;
+	for (int below = 1; child->getParent() != NULL; ++below)
+	{
+		NodeType* parent = child->getParent();
+		NodeType* sibling = parent->getLeft() == child ? parent->getRight() : parent->getLeft();
+		count += 1 + countNodes(sibling);
+		if (below > this->rebalanceFactor_ * std::log2(static_cast<double>(count)))
+		{
+			rebuildSubtree(parent, count);
+			return;
+		}
+		child = parent;
+	}
+}
+
+/**
+* Called when an insert finds its key already present, after any new
+* value is stored. Nothing to do for a plain BST; SplayTree splays.
+*/
+template<class Key, class Value, class Compare, class NodeAlloc, class NodeType>
+void BinarySearchTree<Key, Value, Compare, NodeAlloc, NodeType>::foundOnInsert(NodeType*)
+{
+
+}
+
+/**
+* Called for every node placed by assign() or rebalance(), after its
+* subtrees, with the height of its right subtree minus that of its left
+* and the number of nodes in each. A plain BST keeps no balance.
+*/
+template<class Key, class Value, class Compare, class NodeAlloc, class NodeType>
+void BinarySearchTree<Key, Value, Compare, NodeAlloc, NodeType>::setBuiltBalance(NodeType* node, int balance, size_t leftCount, size_t rightCount)
+{
+}
+
+
+/**
+* A remove method to remove a specific key from a Binary Search Tree.
+* Recall: The writeup specifies that if a node has 2 children you
+* should swap with the predecessor and then remove.
+*/
+template<typename Key, typename Value, typename Compare, typename NodeAlloc, typename NodeType>
+void BinarySearchTree<Key, Value, Compare, NodeAlloc, NodeType>::remove(const Key& key)
+{
+    // TODO
+		NodeType* nodeToRemove = internalFind(key);
+		if (nodeToRemove == NULL) // node not in tree 
+		{
+			return;
+		}
+        // 2 children
+		if (nodeToRemove->getLeft() != NULL && nodeToRemove->getRight() != NULL)
+		{
+            
+			NodeType* predec = predecessor(nodeToRemove); 
+			nodeSwap(nodeToRemove, predec); // this will make predecessor the root if nodeToRemove was the root
+		}
+		detachBookkeeping(nodeToRemove);
+		NodeType* parent = nodeToRemove->getParent();
+		// no children
+		if (nodeToRemove->getLeft() == NULL && nodeToRemove->getRight() == NULL)
+		{
+			if (nodeToRemove == this->root_) // no children, and it's the root - must be the only node in tree 
+			{
+			    this->clear();
+					return;
+			}
+			else if (nodeToRemove->getParent()->getLeft() == nodeToRemove)
+			{
+				(nodeToRemove->getParent())->setLeft(NULL);	
+			}
+			else if (nodeToRemove->getParent()->getRight() == nodeToRemove)
+			{
+				(nodeToRemove->getParent())->setRight(NULL);	
+			}
+			this->alloc_.destroy(nodeToRemove);
+			nodeToRemove = NULL; 
+		}
+		// 1 child (left)
+		else if (nodeToRemove->getLeft() != NULL && nodeToRemove->getRight() == NULL)
+		{
+			promote(nodeToRemove->getLeft());
+			this->alloc_.destroy(nodeToRemove);
+			nodeToRemove = NULL;
+		}
+		// 1 child (right)
+		else if (nodeToRemove->getLeft() == NULL && nodeToRemove->getRight() != NULL)
+		{
+			promote(nodeToRemove->getRight());
+			this->alloc_.destroy(nodeToRemove);
+			nodeToRemove = NULL;
+		}
+		refreshPath(parent);
+}
+ 
+ 
+ //4 is on the right of the node were removing BUT its on the left of the grandparent node 
+
+
+// promote
+// set grandparent of node toPromote to be the parent of toPromote
+// set the child of the old grandparent of toPromote to be toPromote instead of toPromote's parent 
+template<typename Key, typename Value, typename Compare, typename NodeAlloc, typename NodeType>
+void BinarySearchTree<Key, Value, Compare, NodeAlloc, NodeType>::promote(NodeType* toPromote)
+{
+	if (toPromote->getParent() == this->root_) // is nodeToRemove is the root node, need to make nodetoPromote the new root_
+	{
+		this->root_ = toPromote;
+	}
+	NodeType* grandparent = (toPromote->getParent())->getParent(); 
+	if (grandparent != NULL) // if we didnt just make it a root_
+	{
+		if (toPromote->getParent() == grandparent->getLeft())
+		{
+			grandparent->setLeft(toPromote); 
+		}
+		else if (toPromote->getParent() == grandparent->getRight())
 		{
 			grandparent->setRight(toPromote);
 		}
@@ -597,139 +1659,704 @@ void BinarySearchTree<Key, Value>::promote(Node<Key, Value>* toPromote)
 
 
 
-template<class Key, class Value>
-Node<Key, Value>*
-BinarySearchTree<Key, Value>::predecessor(Node<Key, Value>* current)
-{
-    // TODO
-		if (current == NULL)
+template<class Key, class Value, class Compare, class NodeAlloc, class NodeType>
+NodeType*
+BinarySearchTree<Key, Value, Compare, NodeAlloc, NodeType>::predecessor(NodeType* current)
+{
+    // TODO
+		if (current == NULL)
+		{
+			return NULL;
+		}
+		NodeType* currentcopy;
+		if (current->getLeft() != NULL)
+		{
+			current = current->getLeft();
+			currentcopy = current;
+			while (current != NULL)
+			{
+				current = current->getRight();
+				if (current != NULL)
+				{
+					currentcopy = current;
+				}
+			}
+			return currentcopy;
+		}
+		else // no left child
+		{
+			if (current->getParent() == NULL) // we've reached root since parent of current = null 
+			{
+				return NULL;
+			}
+			while(current != (current->getParent())->getRight())
+			{
+				current = current->getParent();
+				if (current->getParent() == NULL)
+				{
+					return NULL;
+				}
+			}
+			return current->getParent();
+		}
+}
+
+template<class Key, class Value, class Compare, class NodeAlloc, class NodeType>
+NodeType*
+BinarySearchTree<Key, Value, Compare, NodeAlloc, NodeType>::successor(NodeType* current)
+{
+    // TODO
+		if (current == NULL)
+		{
+			return NULL;
+		}
+		NodeType* currentcopy;
+		if (current->getRight() != NULL)
+		{
+			current = current->getRight();
+			currentcopy = current;
+			while (current != NULL)
+			{
+				current = current->getLeft();
+				if (current != NULL)
+				{
+					currentcopy = current;
+				}
+			}
+			return currentcopy;
+		}
+		else // no right child
+		{
+			if (current->getParent() == NULL) // we've reached root since parent of current = null 
+			{
+				return NULL;
+			}
+			while(current != (current->getParent())->getLeft())
+			{
+				current = current->getParent();
+				if (current->getParent() == NULL) // we've reached root since parent of current = null 
+				{
+					return NULL;
+				}
+			}
+			return current->getParent();
+		}
+}
+
+
+/**
+* A method to remove all contents of the tree and
+* reset the values in the tree for use again.
+* When the items (and any node summaries) need no destructor and the
+* allocator can reclaim every node at once (e.g. NodePool), the nodes
+* are never visited.
+*/
+template<typename Key, typename Value, typename Compare, typename NodeAlloc, typename NodeType>
+void BinarySearchTree<Key, Value, Compare, NodeAlloc, NodeType>::clear()
+{
+    // TODO
+		if (!std::is_trivially_destructible<std::pair<const Key, Value> >::value ||
+		    !HasTrivialSummary<NodeType>::value || !this->alloc_.reset())
+		{
+			postOrderTraveralClear(this->root_);
+		}
+		this->root_ = NULL;
+		this->size_ = 0;
+		this->leftmost_ = NULL;
+		this->rightmost_ = NULL;
+}
+
+/**
+* Replaces the contents with the items in [first, last).
+* Input sorted by key is linked straight into a height-balanced tree in
+* O(n), with the nodes allocated in key order; of equal keys the last
+* one is kept, as repeated insert() would. Unsorted input falls back to
+* inserting one item at a time. The range is read twice.
+*/
+template<typename Key, typename Value, typename Compare, typename NodeAlloc, typename NodeType>
+template<typename ForwardIt>
+void BinarySearchTree<Key, Value, Compare, NodeAlloc, NodeType>::assign(ForwardIt first, ForwardIt last)
+{
+	this->clear();
+	std::vector<ForwardIt> items;
+	for (ForwardIt it = first; it != last; ++it)
+	{
+		if (!items.empty())
+		{
+			int order = compareKeys((*items.back()).first, (*it).first);
+			if (order > 0) // not sorted
+			{
+				std::vector<ForwardIt>().swap(items);
+				for (ForwardIt in = first; in != last; ++in)
+				{
+					insert(*in);
+				}
+				return;
+			}
+			if (order == 0)
+			{
+				items.back() = it;
+				continue;
+			}
+		}
+		items.push_back(it);
+	}
+	if (items.empty())
+	{
+		return;
+	}
+
+	std::vector<NodeType*> nodes;
+	nodes.reserve(items.size());
+	for (size_t i = 0; i < items.size(); ++i)
+	{
+		createNode(items[i], nodes);
+	}
+	relinkAll(nodes);
+}
+
+/**
+* Orders iterators to items by the key of the item, for insertBatch().
+*/
+template<typename Key, typename Value, typename Compare, typename NodeAlloc, typename NodeType>
+template<typename ForwardIt>
+struct BinarySearchTree<Key, Value, Compare, NodeAlloc, NodeType>::IteratorKeyLess
+{
+	IteratorKeyLess(const Compare& comp) : comp_(comp) { }
+
+	bool operator()(const ForwardIt& a, const ForwardIt& b) const
+	{
+		return comp_((*a).first, (*b).first);
+	}
+
+	Compare comp_;
+};
+
+/**
+* Inserts every item of [first, last), overwriting existing values like
+* insert(); of equal keys within the batch the last one wins.
+* The batch is sorted by key first, without copying the items. A batch
+* that is large next to the tree is merged with the tree's nodes in one
+* in-order pass and the result relinked into a balanced shape, reusing
+* every existing node, so no rebalancing happens per item. A smaller
+* batch is inserted in key order, so that consecutive descents follow
+* paths that are still in cache.
+*/
+template<typename Key, typename Value, typename Compare, typename NodeAlloc, typename NodeType>
+template<typename ForwardIt>
+void BinarySearchTree<Key, Value, Compare, NodeAlloc, NodeType>::insertBatch(ForwardIt first, ForwardIt last)
+{
+	std::vector<ForwardIt> batch;
+	for (ForwardIt it = first; it != last; ++it)
+	{
+		batch.push_back(it);
+	}
+	std::stable_sort(batch.begin(), batch.end(), IteratorKeyLess<ForwardIt>(this->comp_));
+	size_t unique = 0;
+	for (size_t i = 0; i < batch.size(); ++i)
+	{
+		if (unique > 0 && compareKeys((*batch[unique - 1]).first, (*batch[i]).first) == 0)
+		{
+			batch[unique - 1] = batch[i];
+		}
+		else
+		{
+			batch[unique++] = batch[i];
+		}
+	}
+	batch.resize(unique);
+
+	// merging walks every node; inserting costs a descent per item
+	if (batch.size() * MERGE_RATIO < this->size())
+	{
+		for (size_t i = 0; i < batch.size(); ++i)
+		{
+			insert(*batch[i]);
+		}
+		return;
+	}
+
+	std::vector<NodeType*> merged;
+	merged.reserve(this->size_ + batch.size());
+	std::vector<NodeType*> created;
+	NodeType* current = this->leftmost_;
+	size_t next = 0;
+	try
+	{
+		while (current != NULL || next < batch.size())
+		{
+			int order = current == NULL ? 1 : next == batch.size() ? -1
+				: compareKeys(current->getKey(), (*batch[next]).first);
+			if (order < 0)
+			{
+				merged.push_back(current);
+				current = successor(current);
+			}
+			else if (order > 0)
+			{
+				merged.push_back(createNode(batch[next++], created));
+			}
+			else
+			{
+				current->getValue() = (*batch[next++]).second;
+				merged.push_back(current);
+				current = successor(current);
+			}
+		}
+	}
+	catch (...)
+	{
+		for (size_t i = 0; i < created.size(); ++i)
+		{
+			this->alloc_.destroy(created[i]);
+		}
+		throw;
+	}
+	relinkAll(merged);
+}
+
+/**
+* Creates a detached node from *item and records it in created. If that
+* throws, every node in created is destroyed first.
+*/
+template<typename Key, typename Value, typename Compare, typename NodeAlloc, typename NodeType>
+template<typename ForwardIt>
+NodeType* BinarySearchTree<Key, Value, Compare, NodeAlloc, NodeType>::createNode(ForwardIt item, std::vector<NodeType*>& created)
+{
+	try
+	{
+		created.push_back(this->alloc_.template create<NodeType>(EmplaceTag(), nullptr, *item));
+	}
+	catch (...)
+	{
+		for (size_t i = 0; i < created.size(); ++i)
+		{
+			this->alloc_.destroy(created[i]);
+		}
+		created.clear();
+		throw;
+	}
+	return created.back();
+}
+
+template<typename Key, typename Value, typename Compare, typename NodeAlloc, typename NodeType>
+void BinarySearchTree<Key, Value, Compare, NodeAlloc, NodeType>::rebalance()
+{
+	if (this->root_ != NULL)
+	{
+		rebuildSubtree(this->root_, this->size());
+	}
+}
+
+template<typename Key, typename Value, typename Compare, typename NodeAlloc, typename NodeType>
+void BinarySearchTree<Key, Value, Compare, NodeAlloc, NodeType>::setAutoRebalance(double factor)
+{
+	if (factor != 0 && !(factor > 1))
+	{
+		throw std::invalid_argument("setAutoRebalance: factor must be 0 or above 1");
+	}
+	this->rebalanceFactor_ = factor;
+}
+
+/**
+* Relinks the tree as a weight-balanced search tree, weighting each key by
+* its hits plus one so that keys never found still count. Each subtree
+* root is the key whose weight spans the middle of its range's total
+* weight (Mehlhorn's bisection rule), which puts a key of weight w at
+* depth O(log(W / w)) and costs within a small constant of the optimal
+* expected search length. O(n log n) time and O(n) temporary space; the
+* depth, and so the recursion, stays below log2(W) + 2.
+*/
+template<typename Key, typename Value, typename Compare, typename NodeAlloc, typename NodeType>
+void BinarySearchTree<Key, Value, Compare, NodeAlloc, NodeType>::optimizeForAccess()
+{
+	static_assert(CountsHits<NodeType>::value, "optimizeForAccess() needs a node that counts hits (HitCountNode)");
+	std::vector<NodeType*> nodes;
+	std::vector<uint64_t> prefix(1, 0);
+	for (NodeType* n = this->leftmost_; n != NULL; n = successor(n))
+	{
+		nodes.push_back(n);
+		prefix.push_back(prefix.back() + n->getHits() + 1);
+	}
+	if (nodes.empty())
+	{
+		return;
+	}
+	this->root_ = linkWeighted(&nodes[0], &prefix[0], nodes.size());
+	this->root_->setParent(NULL);
+	for (size_t i = 0; i < nodes.size(); ++i)
+	{
+		nodes[i]->clearHits();
+	}
+}
+
+/**
+* Links nodes[0, count), whose weights are the differences of
+* prefix[0, count], under the one spanning the middle of their weight.
+*/
+template<typename Key, typename Value, typename Compare, typename NodeAlloc, typename NodeType>
+NodeType* BinarySearchTree<Key, Value, Compare, NodeAlloc, NodeType>::linkWeighted(NodeType** nodes, const uint64_t* prefix, size_t count)
+{
+	if (count == 0)
+	{
+		return NULL;
+	}
+	uint64_t middle = prefix[0] + (prefix[count] - prefix[0]) / 2;
+	// the first node whose weight ends past the middle
+	size_t mid = std::upper_bound(prefix + 1, prefix + count + 1, middle) - (prefix + 1);
+	if (mid == count) mid = count - 1;
+	NodeType* node = nodes[mid];
+	NodeType* left = linkWeighted(nodes, prefix, mid);
+	NodeType* right = linkWeighted(nodes + mid + 1, prefix + mid + 1, count - mid - 1);
+	node->setLeft(left);
+	node->setRight(right);
+	if (left != NULL) left->setParent(node);
+	if (right != NULL) right->setParent(node);
+	return node;
+}
+
+template<typename Key, typename Value, typename Compare, typename NodeAlloc, typename NodeType>
+void BinarySearchTree<Key, Value, Compare, NodeAlloc, NodeType>::recordHit(NodeType* node, std::true_type)
+{
+	node->recordHit();
+}
+
+template<typename Key, typename Value, typename Compare, typename NodeAlloc, typename NodeType>
+void BinarySearchTree<Key, Value, Compare, NodeAlloc, NodeType>::recordHit(NodeType*, std::false_type)
+{
+}
+
+/**
+* The nodes in the subtree at root, counted in order through the parent
+* links so that no stack is needed.
+*/
+template<typename Key, typename Value, typename Compare, typename NodeAlloc, typename NodeType>
+size_t BinarySearchTree<Key, Value, Compare, NodeAlloc, NodeType>::countNodes(NodeType* root)
+{
+	if (root == NULL)
+	{
+		return 0;
+	}
+	NodeType* last = root;
+	while (last->getRight() != NULL)
+	{
+		last = last->getRight();
+	}
+	NodeType* node = root;
+	while (node->getLeft() != NULL)
+	{
+		node = node->getLeft();
+	}
+	size_t count = 1;
+	for (; node != last; node = successor(node))
+	{
+		++count;
+	}
+	return count;
+}
+
+/**
+* Counts the nodes of the smaller of the detached subtrees a and b and
+* sets aSmaller when that is a. Counted nodes give both sizes in O(1);
+* otherwise both are walked in step, which stops as soon as one ends and
+* so costs O(log n) plus the smaller size.
+*/
+template<typename Key, typename Value, typename Compare, typename NodeAlloc, typename NodeType>
+size_t BinarySearchTree<Key, Value, Compare, NodeAlloc, NodeType>::countSmaller(NodeType* a, NodeType* b, bool& aSmaller)
+{
+	return countSmaller(a, b, aSmaller, std::integral_constant<bool, CountsSubtree<NodeType>::value>());
+}
+
+template<typename Key, typename Value, typename Compare, typename NodeAlloc, typename NodeType>
+size_t BinarySearchTree<Key, Value, Compare, NodeAlloc, NodeType>::countSmaller(NodeType* a, NodeType* b, bool& aSmaller, std::true_type)
+{
+	size_t countA = subtreeCount(a);
+	size_t countB = subtreeCount(b);
+	aSmaller = countA <= countB;
+	return aSmaller ? countA : countB;
+}
+
+template<typename Key, typename Value, typename Compare, typename NodeAlloc, typename NodeType>
+size_t BinarySearchTree<Key, Value, Compare, NodeAlloc, NodeType>::countSmaller(NodeType* a, NodeType* b, bool& aSmaller, std::false_type)
+{
+	NodeType* node[2] = { a, b };
+	NodeType* last[2] = { a, b };
+	for (int i = 0; i < 2; ++i)
+	{
+		if (node[i] == NULL)
+		{
+			aSmaller = i == 0;
+			return 0;
+		}
+		while (node[i]->getLeft() != NULL) node[i] = node[i]->getLeft();
+		while (last[i]->getRight() != NULL) last[i] = last[i]->getRight();
+	}
+	for (size_t count = 1; ; ++count)
+	{
+		for (int i = 0; i < 2; ++i)
+		{
+			if (node[i] == last[i])
+			{
+				aSmaller = i == 0;
+				return count;
+			}
+			node[i] = successor(node[i]);
+		}
+	}
+}
+
+/**
+* Rebuilds the subtree at top, of count nodes, in place with Day-Stout-
+* Warren: rotating every left child up flattens it into a vine linked
+* through the right links, and compressVine() folds that into a complete
+* tree. Its shape then follows from count alone, so a walk over the
+* parent links (set on the way down) can hand each node its subtree
+* sizes and balance, children first. Nothing is allocated and the stack
+* stays flat.
+*/
+template<typename Key, typename Value, typename Compare, typename NodeAlloc, typename NodeType>
+void BinarySearchTree<Key, Value, Compare, NodeAlloc, NodeType>::rebuildSubtree(NodeType* top, size_t count)
+{
+	NodeType* parent = top->getParent();
+	bool leftChild = parent != NULL && parent->getLeft() == top;
+
+	NodeType* vine = NULL;
+	NodeType* tail = NULL;
+	NodeType* rest = top;
+	while (rest != NULL)
+	{
+		NodeType* left = rest->getLeft();
+		if (left != NULL)
+		{
+			rest->setLeft(left->getRight());
+			left->setRight(rest);
+			rest = left;
+			continue;
+		}
+		if (tail == NULL)
+		{
+			vine = rest;
+		}
+		else
+		{
+			tail->setRight(rest);
+		}
+		tail = rest;
+		rest = rest->getRight();
+	}
+
+	// levels full levels, then bottom nodes in the leftmost slots below
+	size_t levels = 0;
+	while ((size_t(2) << levels) - 1 <= count)
+	{
+		++levels;
+	}
+	size_t bottom = count - ((size_t(1) << levels) - 1);
+	compressVine(vine, bottom);
+	for (size_t spine = count - bottom; spine > 1; spine /= 2)
+	{
+		compressVine(vine, spine / 2);
+	}
+
+	vine->setParent(parent);
+	NodeType* node = vine;
+	NodeType* from = parent;
+	size_t depth = 0;
+	size_t pos = 0;
+	while (true)
+	{
+		NodeType* left = node->getLeft();
+		NodeType* right = node->getRight();
+		if (from == node->getParent() && left != NULL)
 		{
-			return NULL;
+			left->setParent(node);
+			from = node;
+			node = left;
+			++depth;
+			pos = 2 * pos;
+			continue;
 		}
-		Node<Key, Value>* currentcopy;
-		if (current->getLeft() != NULL)
+		if ((from == node->getParent() || from == left) && right != NULL)
 		{
-			current = current->getLeft();
-			currentcopy = current;
-			while (current != NULL)
-			{
-				current = current->getRight();
-				if (current != NULL)
-				{
-					currentcopy = current;
-				}
-			}
-			return currentcopy;
+			right->setParent(node);
+			from = node;
+			node = right;
+			++depth;
+			pos = 2 * pos + 1;
+			continue;
 		}
-		else // no left child
+		if (depth < levels)
 		{
-			if (current->getParent() == NULL) // we've reached root since parent of current = null 
-			{
-				return NULL;
-			}
-			while(current != (current->getParent())->getRight())
-			{
-				current = current->getParent();
-				if (current->getParent() == NULL)
-				{
-					return NULL;
-				}
-			}
-			return current->getParent();
+			size_t below = levels - depth - 1;
+			size_t leftCount = completeCount(below, 2 * pos, bottom);
+			size_t rightCount = completeCount(below, 2 * pos + 1, bottom);
+			int leftHeight = static_cast<int>(below) + (leftCount > (size_t(1) << below) - 1);
+			int rightHeight = static_cast<int>(below) + (rightCount > (size_t(1) << below) - 1);
+			setBuiltBalance(node, rightHeight - leftHeight, leftCount, rightCount);
+		}
+		else
+		{
+			setBuiltBalance(node, 0, 0, 0);
+		}
+		refreshNode(node);
+		if (node == vine)
+		{
+			break;
 		}
+		from = node;
+		node = node->getParent();
+		--depth;
+		pos /= 2;
+	}
+
+	if (parent == NULL)
+	{
+		this->root_ = vine;
+	}
+	else if (leftChild)
+	{
+		parent->setLeft(vine);
+	}
+	else
+	{
+		parent->setRight(vine);
+	}
+	refreshPath(parent);
 }
 
-template<class Key, class Value>
-Node<Key, Value>*
-BinarySearchTree<Key, Value>::successor(Node<Key, Value>* current)
+/**
+* One Day-Stout-Warren pass: rotates every other node of the right spine
+* under vine to the left of the next one, rotations times from the top.
+*/
+template<typename Key, typename Value, typename Compare, typename NodeAlloc, typename NodeType>
+void BinarySearchTree<Key, Value, Compare, NodeAlloc, NodeType>::compressVine(NodeType*& vine, size_t rotations)
 {
-    // TODO
-		if (current == NULL)
-		{
-			return NULL;
-		}
-		Node<Key, Value>* currentcopy;
-		if (current->getRight() != NULL)
+	NodeType* scanner = NULL;
+	for (size_t i = 0; i < rotations; ++i)
+	{
+		NodeType* child = scanner == NULL ? vine : scanner->getRight();
+		NodeType* next = child->getRight();
+		child->setRight(next->getLeft());
+		next->setLeft(child);
+		if (scanner == NULL)
 		{
-			current = current->getRight();
-			currentcopy = current;
-			while (current != NULL)
-			{
-				current = current->getLeft();
-				if (current != NULL)
-				{
-					currentcopy = current;
-				}
-			}
-			return currentcopy;
+			vine = next;
 		}
-		else // no right child
+		else
 		{
-			if (current->getParent() == NULL) // we've reached root since parent of current = null 
-			{
-				return NULL;
-			}
-			while(current != (current->getParent())->getLeft())
-			{
-				current = current->getParent();
-				if (current->getParent() == NULL) // we've reached root since parent of current = null 
-				{
-					return NULL;
-				}
-			}
-			return current->getParent();
+			scanner->setRight(next);
 		}
+		scanner = next;
+	}
 }
 
+/**
+* The size of the subtree of a complete tree rooted at position pos of
+* its level, with levels full levels of its own and, under them, the
+* first bottom slots of the tree's last level filled.
+*/
+template<typename Key, typename Value, typename Compare, typename NodeAlloc, typename NodeType>
+size_t BinarySearchTree<Key, Value, Compare, NodeAlloc, NodeType>::completeCount(size_t levels, size_t pos, size_t bottom)
+{
+	size_t width = size_t(1) << levels;
+	size_t first = pos * width;
+	return width - 1 + (bottom <= first ? 0 : std::min(bottom - first, width));
+}
 
 /**
-* A method to remove all contents of the tree and
-* reset the values in the tree for use again.
+* Makes nodes, which are in key order, the whole contents of the tree,
+* linked into a height-balanced shape.
 */
-template<typename Key, typename Value>
-void BinarySearchTree<Key, Value>::clear()
+template<typename Key, typename Value, typename Compare, typename NodeAlloc, typename NodeType>
+void BinarySearchTree<Key, Value, Compare, NodeAlloc, NodeType>::relinkAll(std::vector<NodeType*>& nodes)
 {
-    // TODO
-		postOrderTraveralClear(this->root_);
-		this->root_ = NULL;
+	int height;
+	this->root_ = nodes.empty() ? NULL : linkBalanced(&nodes[0], nodes.size(), height);
+	if (this->root_ != NULL) this->root_->setParent(NULL);
+	this->size_ = nodes.size();
+	this->leftmost_ = nodes.empty() ? NULL : nodes.front();
+	this->rightmost_ = nodes.empty() ? NULL : nodes.back();
 }
 
-template<typename Key, typename Value>
-void BinarySearchTree<Key, Value>::postOrderTraveralClear(Node<Key, Value>* curr)
+/**
+* Links nodes[0, count) into a subtree rooted at the middle node and
+* returns its root, with its height in height. Left subtrees get the
+* extra node, so every balance is 0 or -1.
+*/
+template<typename Key, typename Value, typename Compare, typename NodeAlloc, typename NodeType>
+NodeType* BinarySearchTree<Key, Value, Compare, NodeAlloc, NodeType>::linkBalanced(NodeType** nodes, size_t count, int& height)
 {
-	if (curr == NULL)
+	if (count == 0)
 	{
-		return;
+		height = 0;
+		return NULL;
 	}
+	size_t mid = count / 2;
+	int leftHeight;
+	int rightHeight;
+	NodeType* node = nodes[mid];
+	NodeType* left = linkBalanced(nodes, mid, leftHeight);
+	NodeType* right = linkBalanced(nodes + mid + 1, count - mid - 1, rightHeight);
+	node->setLeft(left);
+	node->setRight(right);
+	if (left != NULL) left->setParent(node);
+	if (right != NULL) right->setParent(node);
+	setBuiltBalance(node, rightHeight - leftHeight, mid, count - mid - 1);
+	refreshNode(node);
+	height = 1 + std::max(leftHeight, rightHeight);
+	return node;
+}
 
-	postOrderTraveralClear(curr->getLeft());
-	postOrderTraveralClear(curr->getRight());
-	
-	//remove(curr->getKey());
-	delete curr;
-	curr = NULL; 
+/**
+* Frees the subtree at curr without recursion, so that degenerate trees
+* (a SplayTree after sorted inserts) cannot overflow the stack: a node
+* with a left child is rotated right until the top has none, then freed.
+* Parent links are left stale, as every node visited is freed.
+*/
+template<typename Key, typename Value, typename Compare, typename NodeAlloc, typename NodeType>
+size_t BinarySearchTree<Key, Value, Compare, NodeAlloc, NodeType>::postOrderTraveralClear(NodeType* curr)
+{
+	size_t freed = 0;
+	while (curr != NULL)
+	{
+		NodeType* left = curr->getLeft();
+		if (left != NULL)
+		{
+			curr->setLeft(left->getRight());
+			left->setRight(curr);
+			curr = left;
+			continue;
+		}
+		NodeType* right = curr->getRight();
+		this->alloc_.destroy(curr);
+		++freed;
+		curr = right;
+	}
+	return freed;
 }
 
 
 
 /**
 * A helper function to find the smallest node in the tree.
+* The node is cached, so this no longer walks the left spine.
 */
-template<typename Key, typename Value>
-Node<Key, Value>*
-BinarySearchTree<Key, Value>::getSmallestNode() const
+template<typename Key, typename Value, typename Compare, typename NodeAlloc, typename NodeType>
+NodeType*
+BinarySearchTree<Key, Value, Compare, NodeAlloc, NodeType>::getSmallestNode() const
 {
     // TODO
-		Node<Key, Value>* current = this->root_;
-		while(current != NULL)
-		{
-			if (current->getLeft() == NULL)
-			{
-				return current;
-			}
-			current = current->getLeft();
-		}
-		return NULL; // root was NULL
+		return this->leftmost_; // NULL when the tree is empty
+}
+
+/**
+* A helper function to find the largest node in the tree, also cached.
+*/
+template<typename Key, typename Value, typename Compare, typename NodeAlloc, typename NodeType>
+NodeType*
+BinarySearchTree<Key, Value, Compare, NodeAlloc, NodeType>::getLargestNode() const
+{
+		return this->rightmost_;
 }
 
 /**
@@ -737,27 +2364,20 @@ BinarySearchTree<Key, Value>::getSmallestNode() const
 * return a pointer to it or NULL if no item with that key
 * exists
 */
-template<typename Key, typename Value>
-Node<Key, Value>* BinarySearchTree<Key, Value>::internalFind(const Key& key) const
+template<typename Key, typename Value, typename Compare, typename NodeAlloc, typename NodeType>
+template<typename K>
+NodeType* BinarySearchTree<Key, Value, Compare, NodeAlloc, NodeType>::internalFind(const K& key) const
 {
     // TODO
-	if (this->root_ == NULL)
-	{
-		return NULL;
-	}
-	Node<Key, Value>* current = this->root_;
-	if (current->getKey() == key)
-	{
-		return current;
-	}
-	//bool foundAlready = 0;
+  NodeType* current = this->root_;
   while(current != NULL)
   {
-      if(current->getKey() > key)
+      int order = compareKeys(key, current->getKey());
+      if(order < 0)
       {
           current = current->getLeft();
       }
-      else if(current->getKey() < key)
+      else if(order > 0)
       {
           current = current->getRight();
       }
@@ -769,11 +2389,263 @@ Node<Key, Value>* BinarySearchTree<Key, Value>::internalFind(const Key& key) con
 	return current; // current = NULL at this point (key not found) 
 }
 
+/**
+* Returns the node with the smallest key greater than key (or equal to
+* it when orEqual), or NULL. One comparison per level, like internalFind.
+*/
+template<typename Key, typename Value, typename Compare, typename NodeAlloc, typename NodeType>
+template<typename K>
+NodeType* BinarySearchTree<Key, Value, Compare, NodeAlloc, NodeType>::ceilingNode(const K& key, bool orEqual) const
+{
+	NodeType* bound = NULL;
+	NodeType* current = this->root_;
+	while(current != NULL)
+	{
+		int order = compareKeys(key, current->getKey());
+		if(order == 0 && orEqual)
+		{
+			return current;
+		}
+		if(order < 0)
+		{
+			// current qualifies; a closer one can only be on the left
+			bound = current;
+			current = current->getLeft();
+		}
+		else
+		{
+			current = current->getRight();
+		}
+	}
+	return bound;
+}
+
+/**
+* Number of keys less than key (or equal to it when orEqual), summed from
+* the counts of the left subtrees passed on the way down.
+*/
+template<typename Key, typename Value, typename Compare, typename NodeAlloc, typename NodeType>
+size_t BinarySearchTree<Key, Value, Compare, NodeAlloc, NodeType>::countBelow(const Key& key, bool orEqual) const
+{
+	size_t count = 0;
+	NodeType* current = this->root_;
+	while(current != NULL)
+	{
+		int order = compareKeys(key, current->getKey());
+		if(order == 0)
+		{
+			return count + subtreeCount(current->getLeft()) + (orEqual ? 1 : 0);
+		}
+		if(order < 0)
+		{
+			current = current->getLeft();
+		}
+		else
+		{
+			count += subtreeCount(current->getLeft()) + 1;
+			current = current->getRight();
+		}
+	}
+	return count;
+}
+
+/**
+* An iterator at node, for derived trees, which cannot reach the
+* iterator's own constructor.
+*/
+template<typename Key, typename Value, typename Compare, typename NodeAlloc, typename NodeType>
+typename BinarySearchTree<Key, Value, Compare, NodeAlloc, NodeType>::iterator
+BinarySearchTree<Key, Value, Compare, NodeAlloc, NodeType>::iteratorAt(NodeType* node)
+{
+	return iterator(node);
+}
+
+/**
+* The node under it, or NULL at end(); the inverse of iteratorAt().
+*/
+template<typename Key, typename Value, typename Compare, typename NodeAlloc, typename NodeType>
+NodeType* BinarySearchTree<Key, Value, Compare, NodeAlloc, NodeType>::nodeAt(const iterator& it)
+{
+	return it.current_;
+}
+
+template<typename Key, typename Value, typename Compare, typename NodeAlloc, typename NodeType>
+size_t BinarySearchTree<Key, Value, Compare, NodeAlloc, NodeType>::subtreeCount(NodeType* node)
+{
+	return node != NULL ? node->getCount() : 0;
+}
+
+/**
+* Returns the node with the largest key less than key (or equal to it
+* when orEqual), or NULL.
+*/
+template<typename Key, typename Value, typename Compare, typename NodeAlloc, typename NodeType>
+template<typename K>
+NodeType* BinarySearchTree<Key, Value, Compare, NodeAlloc, NodeType>::floorNode(const K& key, bool orEqual) const
+{
+	NodeType* bound = NULL;
+	NodeType* current = this->root_;
+	while(current != NULL)
+	{
+		int order = compareKeys(key, current->getKey());
+		if(order == 0 && orEqual)
+		{
+			return current;
+		}
+		if(order > 0)
+		{
+			bound = current;
+			current = current->getRight();
+		}
+		else
+		{
+			current = current->getLeft();
+		}
+	}
+	return bound;
+}
+
+/**
+* Moves every node into one contiguous block, laid out in the given order,
+* so that long-lived trees regain sequential memory access after churn.
+* Links are repaired in place and nothing is reallocated per node.
+* Needs an allocator with compaction support (NodePool). Items are moved
+* into the block when that cannot throw and copied otherwise, so a failed
+* compaction leaves the tree as it was. All iterators and node pointers
+* are invalidated.
+*/
+template<typename Key, typename Value, typename Compare, typename NodeAlloc, typename NodeType>
+void BinarySearchTree<Key, Value, Compare, NodeAlloc, NodeType>::compact(CompactOrder order)
+{
+	std::vector<NodeType*> nodes;
+	if (order == VAN_EMDE_BOAS)
+	{
+		if (this->root_ != NULL)
+		{
+			collectVanEmdeBoas(this->root_, subtreeHeight(this->root_), nodes);
+		}
+	}
+	else
+	{
+		for (NodeType* n = getSmallestNode(); n != NULL; n = successor(n))
+		{
+			nodes.push_back(n);
+		}
+	}
+	if (nodes.empty())
+	{
+		return;
+	}
+
+	NodeType* block = this->alloc_.template beginCompact<NodeType>(nodes.size());
+	size_t built = 0;
+	try
+	{
+		for (; built < nodes.size(); ++built)
+		{
+			new (block + built) NodeType(std::move_if_noexcept(*nodes[built]));
+		}
+	}
+	catch (...)
+	{
+		while (built > 0)
+		{
+			block[--built].~NodeType();
+		}
+		this->alloc_.abortCompact(block);
+		throw;
+	}
+
+	// The new nodes still link to the old ones; each old node forwards to
+	// its replacement through its own parent link.
+	for (size_t i = 0; i < nodes.size(); ++i)
+	{
+		nodes[i]->setParent(block + i);
+	}
+	for (size_t i = 0; i < nodes.size(); ++i)
+	{
+		NodeType* n = block + i;
+		if (n->getParent() != NULL) n->setParent(n->getParent()->getParent());
+		if (n->getLeft() != NULL) n->setLeft(n->getLeft()->getParent());
+		if (n->getRight() != NULL) n->setRight(n->getRight()->getParent());
+	}
+	this->root_ = this->root_->getParent();
+	this->leftmost_ = this->leftmost_->getParent();
+	this->rightmost_ = this->rightmost_->getParent();
+
+	if (!std::is_trivially_destructible<NodeType>::value)
+	{
+		for (size_t i = 0; i < nodes.size(); ++i)
+		{
+			nodes[i]->~NodeType();
+		}
+	}
+	this->alloc_.endCompact(block, nodes.size());
+}
+
+/**
+* Height of the subtree at root, without recursion so that degenerate
+* trees cannot overflow the stack.
+*/
+template<typename Key, typename Value, typename Compare, typename NodeAlloc, typename NodeType>
+int BinarySearchTree<Key, Value, Compare, NodeAlloc, NodeType>::subtreeHeight(NodeType* root)
+{
+	int height = 0;
+	std::vector<std::pair<NodeType*, int> > stack;
+	if (root != NULL) stack.push_back(std::make_pair(root, 1));
+	while (!stack.empty())
+	{
+		std::pair<NodeType*, int> top = stack.back();
+		stack.pop_back();
+		height = std::max(height, top.second);
+		if (top.first->getLeft() != NULL) stack.push_back(std::make_pair(top.first->getLeft(), top.second + 1));
+		if (top.first->getRight() != NULL) stack.push_back(std::make_pair(top.first->getRight(), top.second + 1));
+	}
+	return height;
+}
+
+/**
+* Appends the top `levels` levels of the subtree at root in van Emde Boas
+* order: the top half of the levels first, then each subtree hanging below
+* it from left to right, each laid out the same way.
+*/
+template<typename Key, typename Value, typename Compare, typename NodeAlloc, typename NodeType>
+void BinarySearchTree<Key, Value, Compare, NodeAlloc, NodeType>::collectVanEmdeBoas(NodeType* root, int levels, std::vector<NodeType*>& out)
+{
+	if (levels == 1)
+	{
+		out.push_back(root);
+		return;
+	}
+	int top = levels / 2;
+	collectVanEmdeBoas(root, top, out);
+
+	// the bottom subtrees are rooted exactly `top` levels below root
+	std::vector<NodeType*> bottoms;
+	std::vector<std::pair<NodeType*, int> > stack(1, std::make_pair(root, 0));
+	while (!stack.empty())
+	{
+		std::pair<NodeType*, int> curr = stack.back();
+		stack.pop_back();
+		if (curr.second == top)
+		{
+			bottoms.push_back(curr.first);
+			continue;
+		}
+		if (curr.first->getRight() != NULL) stack.push_back(std::make_pair(curr.first->getRight(), curr.second + 1));
+		if (curr.first->getLeft() != NULL) stack.push_back(std::make_pair(curr.first->getLeft(), curr.second + 1));
+	}
+	for (size_t i = 0; i < bottoms.size(); ++i)
+	{
+		collectVanEmdeBoas(bottoms[i], levels - top, out);
+	}
+}
+
 /**
  * Return true iff the BST is balanced.
  */
-template<typename Key, typename Value>
-bool BinarySearchTree<Key, Value>::isBalanced() const
+template<typename Key, typename Value, typename Compare, typename NodeAlloc, typename NodeType>
+bool BinarySearchTree<Key, Value, Compare, NodeAlloc, NodeType>::isBalanced() const
 {
   if (this->root_ == NULL)
 	{
@@ -794,8 +2666,8 @@ bool BinarySearchTree<Key, Value>::isBalanced() const
 /// @brief Calculates the height of the tree if it is balanced. Otherwise returns -1.
 /// @param root The root of the tree to calculate height of
 /// @return the height of the tree if its balanced, otherwise -1
-template<typename Key, typename Value>
-int BinarySearchTree<Key, Value>::calculateHeightIfBalanced(Node<Key, Value>* root, bool* unbalancedbool) const
+template<typename Key, typename Value, typename Compare, typename NodeAlloc, typename NodeType>
+int BinarySearchTree<Key, Value, Compare, NodeAlloc, NodeType>::calculateHeightIfBalanced(NodeType* root, bool* unbalancedbool) const
 {
 	// Base case: an empty tree is always balanced and has a height of 0
 	if (root == NULL) return 0;
@@ -816,25 +2688,25 @@ int BinarySearchTree<Key, Value>::calculateHeightIfBalanced(Node<Key, Value>* ro
 
 
 
-template<typename Key, typename Value>
-void BinarySearchTree<Key, Value>::nodeSwap( Node<Key,Value>* n1, Node<Key,Value>* n2)
+template<typename Key, typename Value, typename Compare, typename NodeAlloc, typename NodeType>
+void BinarySearchTree<Key, Value, Compare, NodeAlloc, NodeType>::nodeSwap( NodeType* n1, NodeType* n2)
 {
     if((n1 == n2) || (n1 == NULL) || (n2 == NULL) ) {
         return;
     }
-    Node<Key, Value>* n1p = n1->getParent();
-    Node<Key, Value>* n1r = n1->getRight();
-    Node<Key, Value>* n1lt = n1->getLeft();
+    NodeType* n1p = n1->getParent();
+    NodeType* n1r = n1->getRight();
+    NodeType* n1lt = n1->getLeft();
     bool n1isLeft = false;
     if(n1p != NULL && (n1 == n1p->getLeft())) n1isLeft = true;
-    Node<Key, Value>* n2p = n2->getParent();
-    Node<Key, Value>* n2r = n2->getRight();
-    Node<Key, Value>* n2lt = n2->getLeft();
+    NodeType* n2p = n2->getParent();
+    NodeType* n2r = n2->getRight();
+    NodeType* n2lt = n2->getLeft();
     bool n2isLeft = false;
     if(n2p != NULL && (n2 == n2p->getLeft())) n2isLeft = true;
 
 
-    Node<Key, Value>* temp;
+    NodeType* temp;
     temp = n1->getParent();
     n1->setParent(n2->getParent());
     n2->setParent(temp);
@@ -898,6 +2770,12 @@ void BinarySearchTree<Key, Value>::nodeSwap( Node<Key,Value>* n1, Node<Key,Value
         this->root_ = n1;
     }
 
+    // the cached extremes name positions, which the nodes just traded
+    if(this->leftmost_ == n1) this->leftmost_ = n2;
+    else if(this->leftmost_ == n2) this->leftmost_ = n1;
+    if(this->rightmost_ == n1) this->rightmost_ = n2;
+    else if(this->rightmost_ == n2) this->rightmost_ = n1;
+
 }
 
 /**
@@ -920,4 +2798,25 @@ End implementations for the BinarySearchTree class.
 ---------------------------------------------------
 */
 
+/**
+* A BinarySearchTree whose nodes live in a per-tree arena of chunks and
+* link to each other with 32-bit indices, for large trees of small items.
+*/
+template <typename Key, typename Value, typename Compare = std::less<Key> >
+using IndexedBinarySearchTree = BinarySearchTree<Key, Value, Compare, ArenaNodeAllocator, IndexNode<Key, Value> >;
+
+/**
+* A BinarySearchTree that keeps keys and links in compact nodes and the
+* items in a separate pool, for lookup-heavy use with large values.
+*/
+template <typename Key, typename Value, typename Compare = std::less<Key> >
+using SplitBinarySearchTree = BinarySearchTree<Key, Value, Compare, SplitNodeAllocator<>, SplitNode<Key, Value> >;
+
+/**
+* A BinarySearchTree whose nodes count find() hits, so that
+* optimizeForAccess() can reshape it around a stable lookup profile.
+*/
+template <typename Key, typename Value, typename Compare = std::less<Key> >
+using HitCountTree = BinarySearchTree<Key, Value, Compare, NewDeleteNodeAllocator, HitCountNode<Key, Value> >;
+
 #endif
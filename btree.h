@@ -0,0 +1,797 @@
+#ifndef BTREE_H
+#define BTREE_H
+
+#include <cstddef>
+#include <functional>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+/**
+* An ordered map kept in a B+ tree: every item sits in a leaf holding up
+* to Fanout of them in one sorted array, and the branches above hold up
+* to Fanout children with copies of the keys that separate them. A lookup
+* binary-searches one contiguous array per level, and with the default
+* fan-out a million keys are five levels deep instead of the twenty-odd
+* separate nodes an AVLTree descent visits. Small items gain from a
+* larger Fanout; large ones pay for it in the shifting on every insert.
+* Leaves are linked left to right, so iteration walks arrays rather than
+* parent links.
+*
+* The interface and iterator behave like BinarySearchTree's. Keys must be
+* copyable, since separators are copies. Any insert or remove invalidates
+* iterators: items move when their leaf is split, merged or shifted.
+* Everything that can fail (the new item, a new node, a separator copy)
+* is made before anything is shifted, so a throw leaves the map intact;
+* moving an item or key from slot to slot is assumed not to throw.
+*/
+template <typename Key, typename Value, size_t Fanout = 32,
+          typename Compare = std::less<Key> >
+class BTreeMap
+{
+    static_assert(Fanout >= 4, "BTreeMap needs a fan-out of at least 4");
+
+    struct Leaf;
+
+public:
+    typedef std::pair<const Key, Value> ItemType;
+    typedef Compare key_compare;
+
+    BTreeMap();
+    explicit BTreeMap(const Compare& comp);
+    ~BTreeMap();
+
+    /**
+    * Walks the items of one leaf, then follows its link to the next.
+    */
+    class iterator
+    {
+    public:
+        iterator();
+
+        ItemType& operator*() const;
+        ItemType* operator->() const;
+
+        bool operator==(const iterator& rhs) const;
+        bool operator!=(const iterator& rhs) const;
+
+        iterator& operator++();
+
+    protected:
+        friend class BTreeMap<Key, Value, Fanout, Compare>;
+        iterator(Leaf* leaf, size_t index);
+
+        Leaf* leaf_;   // NULL at the end
+        size_t index_;
+    };
+
+    iterator begin() const;
+    iterator end() const;
+    iterator find(const Key& key) const;
+    Value& operator[](const Key& key);
+    Value const & operator[](const Key& key) const;
+    Compare key_comp() const;
+
+    // The bool is true when an item was added, false when the key existed
+    // and its value was overwritten.
+    std::pair<iterator, bool> insert(const ItemType& keyValuePair);
+    std::pair<iterator, bool> insert(ItemType&& keyValuePair);
+    void remove(const Key& key);
+    void clear();
+    bool empty() const;
+    size_t size() const;
+    int height() const;   // levels, leaves included; 0 when empty
+
+private:
+    // Copies would have to rebuild every node; none are needed yet.
+    BTreeMap(const BTreeMap&);
+    BTreeMap& operator=(const BTreeMap&);
+
+    // count is the number of items in a leaf, or of keys in a branch,
+    // which then has count + 1 children.
+    struct NodeBase
+    {
+        explicit NodeBase(bool isLeaf) : leaf(isLeaf), count(0) {}
+        bool leaf;
+        size_t count;
+    };
+
+    struct Leaf : NodeBase
+    {
+        Leaf() : NodeBase(true), next(NULL) {}
+        ItemType* item(size_t i)
+        {
+            return reinterpret_cast<ItemType*>(&items[i]);
+        }
+        typename std::aligned_storage<sizeof(ItemType), alignof(ItemType)>::type items[Fanout];
+        Leaf* next;
+    };
+
+    // Every key in children[i] is less than key(i), and every key in
+    // children[i + 1] is at least key(i).
+    struct Branch : NodeBase
+    {
+        Branch() : NodeBase(false) {}
+        Key* key(size_t i)
+        {
+            return reinterpret_cast<Key*>(&keys[i]);
+        }
+        typename std::aligned_storage<sizeof(Key), alignof(Key)>::type keys[Fanout - 1];
+        NodeBase* children[Fanout];
+    };
+
+    // Leaves split into halves of Fanout / 2 and up, branches into halves
+    // of Fanout / 2 children and up; only the root may hold fewer.
+    static const size_t MIN_ITEMS = Fanout / 2;
+    static const size_t MIN_KEYS = Fanout / 2 - 1;
+
+    bool less(const Key& a, const Key& b) const;
+    size_t leafLowerBound(Leaf* leaf, const Key& key) const;
+    size_t childIndex(Branch* branch, const Key& key) const;
+    Leaf* findLeaf(const Key& key) const;
+    template<typename P>
+    std::pair<iterator, bool> insertItem(P&& keyValuePair);
+    static bool isFull(NodeBase* node);
+    static bool atMinimum(NodeBase* node);
+    void splitChild(Branch* parent, size_t i);
+    static void openSlot(Branch* parent, size_t i);
+    size_t refillChild(Branch* parent, size_t i);
+    void borrowFromLeft(Branch* parent, size_t i);
+    void borrowFromRight(Branch* parent, size_t i);
+    void mergeChildren(Branch* parent, size_t i);
+    template<typename T>
+    static void relocate(T* to, T* from);
+    static void destroyNode(NodeBase* node);
+
+    NodeBase* root_;   // NULL when empty
+    size_t size_;
+    Compare comp_;
+};
+
+/*
+-------------------------------------------------------
+Begin implementations for the BTreeMap::iterator class.
+-------------------------------------------------------
+*/
+
+template<class Key, class Value, size_t Fanout, class Compare>
+BTreeMap<Key, Value, Fanout, Compare>::iterator::iterator() :
+    leaf_(NULL),
+    index_(0)
+{
+
+}
+
+template<class Key, class Value, size_t Fanout, class Compare>
+BTreeMap<Key, Value, Fanout, Compare>::iterator::iterator(Leaf* leaf, size_t index) :
+    leaf_(leaf),
+    index_(index)
+{
+
+}
+
+template<class Key, class Value, size_t Fanout, class Compare>
+std::pair<const Key, Value>&
+BTreeMap<Key, Value, Fanout, Compare>::iterator::operator*() const
+{
+    return *leaf_->item(index_);
+}
+
+template<class Key, class Value, size_t Fanout, class Compare>
+std::pair<const Key, Value>*
+BTreeMap<Key, Value, Fanout, Compare>::iterator::operator->() const
+{
+    return leaf_->item(index_);
+}
+
+template<class Key, class Value, size_t Fanout, class Compare>
+bool
+BTreeMap<Key, Value, Fanout, Compare>::iterator::operator==(const iterator& rhs) const
+{
+    return leaf_ == rhs.leaf_ && index_ == rhs.index_;
+}
+
+template<class Key, class Value, size_t Fanout, class Compare>
+bool
+BTreeMap<Key, Value, Fanout, Compare>::iterator::operator!=(const iterator& rhs) const
+{
+    return !(*this == rhs);
+}
+
+template<class Key, class Value, size_t Fanout, class Compare>
+typename BTreeMap<Key, Value, Fanout, Compare>::iterator&
+BTreeMap<Key, Value, Fanout, Compare>::iterator::operator++()
+{
+    if(++index_ == leaf_->count)
+    {
+        leaf_ = leaf_->next;
+        index_ = 0;
+    }
+    return *this;
+}
+
+/*
+-----------------------------------------------------
+End implementations for the BTreeMap::iterator class.
+-----------------------------------------------------
+*/
+
+template<class Key, class Value, size_t Fanout, class Compare>
+BTreeMap<Key, Value, Fanout, Compare>::BTreeMap() :
+    root_(NULL),
+    size_(0)
+{
+
+}
+
+template<class Key, class Value, size_t Fanout, class Compare>
+BTreeMap<Key, Value, Fanout, Compare>::BTreeMap(const Compare& comp) :
+    root_(NULL),
+    size_(0),
+    comp_(comp)
+{
+
+}
+
+template<class Key, class Value, size_t Fanout, class Compare>
+BTreeMap<Key, Value, Fanout, Compare>::~BTreeMap()
+{
+    clear();
+}
+
+template<class Key, class Value, size_t Fanout, class Compare>
+bool BTreeMap<Key, Value, Fanout, Compare>::empty() const
+{
+    return size_ == 0;
+}
+
+template<class Key, class Value, size_t Fanout, class Compare>
+size_t BTreeMap<Key, Value, Fanout, Compare>::size() const
+{
+    return size_;
+}
+
+/**
+* All leaves are at the same depth, so this is the length of any
+* root-to-leaf path.
+*/
+template<class Key, class Value, size_t Fanout, class Compare>
+int BTreeMap<Key, Value, Fanout, Compare>::height() const
+{
+    if(root_ == NULL) return 0;
+    int levels = 1;
+    for(NodeBase* node = root_; !node->leaf; ++levels)
+    {
+        node = static_cast<Branch*>(node)->children[0];
+    }
+    return levels;
+}
+
+template<class Key, class Value, size_t Fanout, class Compare>
+Compare BTreeMap<Key, Value, Fanout, Compare>::key_comp() const
+{
+    return comp_;
+}
+
+template<class Key, class Value, size_t Fanout, class Compare>
+typename BTreeMap<Key, Value, Fanout, Compare>::iterator
+BTreeMap<Key, Value, Fanout, Compare>::begin() const
+{
+    if(root_ == NULL) return end();
+    NodeBase* node = root_;
+    while(!node->leaf)
+    {
+        node = static_cast<Branch*>(node)->children[0];
+    }
+    return iterator(static_cast<Leaf*>(node), 0);
+}
+
+template<class Key, class Value, size_t Fanout, class Compare>
+typename BTreeMap<Key, Value, Fanout, Compare>::iterator
+BTreeMap<Key, Value, Fanout, Compare>::end() const
+{
+    return iterator();
+}
+
+template<class Key, class Value, size_t Fanout, class Compare>
+typename BTreeMap<Key, Value, Fanout, Compare>::iterator
+BTreeMap<Key, Value, Fanout, Compare>::find(const Key& key) const
+{
+    Leaf* leaf = findLeaf(key);
+    if(leaf == NULL) return end();
+    size_t pos = leafLowerBound(leaf, key);
+    if(pos == leaf->count || less(key, leaf->item(pos)->first)) return end();
+    return iterator(leaf, pos);
+}
+
+/**
+ * @precondition The key exists in the map
+ * Returns the value associated with the key
+ */
+template<class Key, class Value, size_t Fanout, class Compare>
+Value& BTreeMap<Key, Value, Fanout, Compare>::operator[](const Key& key)
+{
+    iterator it = find(key);
+    if(it == end()) throw std::out_of_range("Invalid key");
+    return it->second;
+}
+
+template<class Key, class Value, size_t Fanout, class Compare>
+Value const & BTreeMap<Key, Value, Fanout, Compare>::operator[](const Key& key) const
+{
+    iterator it = find(key);
+    if(it == end()) throw std::out_of_range("Invalid key");
+    return it->second;
+}
+
+template<class Key, class Value, size_t Fanout, class Compare>
+std::pair<typename BTreeMap<Key, Value, Fanout, Compare>::iterator, bool>
+BTreeMap<Key, Value, Fanout, Compare>::insert(const ItemType& keyValuePair)
+{
+    return insertItem(keyValuePair);
+}
+
+/**
+* As above, but the item is moved into the leaf, or only the value is
+* moved over the existing one.
+*/
+template<class Key, class Value, size_t Fanout, class Compare>
+std::pair<typename BTreeMap<Key, Value, Fanout, Compare>::iterator, bool>
+BTreeMap<Key, Value, Fanout, Compare>::insert(ItemType&& keyValuePair)
+{
+    return insertItem(std::move(keyValuePair));
+}
+
+/**
+* Descends in one pass, splitting every full node on the way before
+* stepping into it, so the leaf reached always has room and no split
+* ever has to climb back up. A full root is split under a new root,
+* which is the only way the tree grows taller.
+*
+* The item is built first: keyValuePair may be an item of this map,
+* which the splits and the shift would move out from under it.
+*/
+template<class Key, class Value, size_t Fanout, class Compare>
+template<typename P>
+std::pair<typename BTreeMap<Key, Value, Fanout, Compare>::iterator, bool>
+BTreeMap<Key, Value, Fanout, Compare>::insertItem(P&& keyValuePair)
+{
+    ItemType item(std::forward<P>(keyValuePair));
+    const Key& key = item.first;
+    if(root_ == NULL)
+    {
+        root_ = new Leaf;
+    }
+    else if(isFull(root_))
+    {
+        Branch* top = new Branch;
+        top->children[0] = root_;
+        root_ = top;
+        try
+        {
+            splitChild(top, 0);
+        }
+        catch(...)
+        {
+            root_ = top->children[0];
+            delete top;
+            throw;
+        }
+    }
+    NodeBase* node = root_;
+    while(!node->leaf)
+    {
+        Branch* branch = static_cast<Branch*>(node);
+        size_t i = childIndex(branch, key);
+        if(isFull(branch->children[i]))
+        {
+            splitChild(branch, i);
+            if(!less(key, *branch->key(i))) ++i;
+        }
+        node = branch->children[i];
+    }
+    Leaf* leaf = static_cast<Leaf*>(node);
+    size_t pos = leafLowerBound(leaf, key);
+    if(pos < leaf->count && !less(key, leaf->item(pos)->first))
+    {
+        leaf->item(pos)->second = std::move(item.second);
+        return std::make_pair(iterator(leaf, pos), false);
+    }
+    for(size_t i = leaf->count; i > pos; --i)
+    {
+        relocate(leaf->item(i), leaf->item(i - 1));
+    }
+    new (leaf->item(pos)) ItemType(std::move(item));
+    ++leaf->count;
+    ++size_;
+    return std::make_pair(iterator(leaf, pos), true);
+}
+
+/**
+* Descends in one pass like insert(), topping up every child at its
+* minimum before stepping into it, so the leaf reached can always give
+* up an item. A root branch left with one child is replaced by it.
+*/
+template<class Key, class Value, size_t Fanout, class Compare>
+void BTreeMap<Key, Value, Fanout, Compare>::remove(const Key& key)
+{
+    if(root_ == NULL) return;
+    NodeBase* node = root_;
+    while(!node->leaf)
+    {
+        Branch* branch = static_cast<Branch*>(node);
+        size_t i = childIndex(branch, key);
+        if(atMinimum(branch->children[i]))
+        {
+            i = refillChild(branch, i);
+        }
+        node = branch->children[i];
+        if(branch == root_ && branch->count == 0)
+        {
+            root_ = node;
+            delete branch;
+        }
+    }
+    Leaf* leaf = static_cast<Leaf*>(node);
+    size_t pos = leafLowerBound(leaf, key);
+    if(pos == leaf->count || less(key, leaf->item(pos)->first)) // key not in tree
+    {
+        return;
+    }
+    leaf->item(pos)->~ItemType();
+    for(size_t i = pos + 1; i < leaf->count; ++i)
+    {
+        relocate(leaf->item(i - 1), leaf->item(i));
+    }
+    --leaf->count;
+    --size_;
+    if(leaf == root_ && leaf->count == 0)
+    {
+        delete leaf;
+        root_ = NULL;
+    }
+}
+
+/**
+* Removes all contents.
+*/
+template<class Key, class Value, size_t Fanout, class Compare>
+void BTreeMap<Key, Value, Fanout, Compare>::clear()
+{
+    if(root_ != NULL)
+    {
+        destroyNode(root_);
+    }
+    root_ = NULL;
+    size_ = 0;
+}
+
+template<class Key, class Value, size_t Fanout, class Compare>
+bool BTreeMap<Key, Value, Fanout, Compare>::less(const Key& a, const Key& b) const
+{
+    return comp_(a, b);
+}
+
+/**
+* Index of the first item in leaf whose key is not less than key.
+*/
+template<class Key, class Value, size_t Fanout, class Compare>
+size_t BTreeMap<Key, Value, Fanout, Compare>::leafLowerBound(Leaf* leaf, const Key& key) const
+{
+    size_t lo = 0;
+    size_t hi = leaf->count;
+    while(lo < hi)
+    {
+        size_t mid = (lo + hi) / 2;
+        if(less(leaf->item(mid)->first, key)) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+/**
+* Index of the child of branch whose range holds key: the number of
+* separators not greater than key.
+*/
+template<class Key, class Value, size_t Fanout, class Compare>
+size_t BTreeMap<Key, Value, Fanout, Compare>::childIndex(Branch* branch, const Key& key) const
+{
+    size_t lo = 0;
+    size_t hi = branch->count;
+    while(lo < hi)
+    {
+        size_t mid = (lo + hi) / 2;
+        if(less(key, *branch->key(mid))) hi = mid;
+        else lo = mid + 1;
+    }
+    return lo;
+}
+
+/**
+* The only leaf that could hold key, or NULL when the map is empty.
+*/
+template<class Key, class Value, size_t Fanout, class Compare>
+typename BTreeMap<Key, Value, Fanout, Compare>::Leaf*
+BTreeMap<Key, Value, Fanout, Compare>::findLeaf(const Key& key) const
+{
+    NodeBase* node = root_;
+    if(node == NULL) return NULL;
+    while(!node->leaf)
+    {
+        Branch* branch = static_cast<Branch*>(node);
+        node = branch->children[childIndex(branch, key)];
+    }
+    return static_cast<Leaf*>(node);
+}
+
+template<class Key, class Value, size_t Fanout, class Compare>
+bool BTreeMap<Key, Value, Fanout, Compare>::isFull(NodeBase* node)
+{
+    return node->count == (node->leaf ? Fanout : Fanout - 1);
+}
+
+template<class Key, class Value, size_t Fanout, class Compare>
+bool BTreeMap<Key, Value, Fanout, Compare>::atMinimum(NodeBase* node)
+{
+    if(node->leaf) return node->count <= MIN_ITEMS;
+    return node->count <= MIN_KEYS;
+}
+
+/**
+* Splits the full child i of parent into two, adding the new right half
+* as child i + 1. A leaf's separator is a copy of the right half's first
+* key; a branch's middle key moves up instead. The separator copy and the
+* new node are made before anything moves.
+*/
+template<class Key, class Value, size_t Fanout, class Compare>
+void BTreeMap<Key, Value, Fanout, Compare>::splitChild(Branch* parent, size_t i)
+{
+    NodeBase* child = parent->children[i];
+    NodeBase* right;
+    const size_t half = Fanout / 2;
+    if(child->leaf)
+    {
+        Leaf* left = static_cast<Leaf*>(child);
+        Key separator(left->item(half)->first);
+        Leaf* newLeaf = new Leaf;
+        openSlot(parent, i);
+        for(size_t j = half; j < Fanout; ++j)
+        {
+            relocate(newLeaf->item(j - half), left->item(j));
+        }
+        newLeaf->count = Fanout - half;
+        left->count = half;
+        newLeaf->next = left->next;
+        left->next = newLeaf;
+        new (parent->key(i)) Key(std::move(separator));
+        right = newLeaf;
+    }
+    else
+    {
+        Branch* left = static_cast<Branch*>(child);
+        Branch* newBranch = new Branch;
+        openSlot(parent, i);
+        for(size_t j = half; j < Fanout - 1; ++j)
+        {
+            relocate(newBranch->key(j - half), left->key(j));
+        }
+        for(size_t j = half; j < Fanout; ++j)
+        {
+            newBranch->children[j - half] = left->children[j];
+        }
+        newBranch->count = Fanout - 1 - half;
+        relocate(parent->key(i), left->key(half - 1));
+        left->count = half - 1;
+        right = newBranch;
+    }
+    parent->children[i + 1] = right;
+    ++parent->count;
+}
+
+/**
+* Moves the keys of parent from i on, and the children after them, one
+* place right, leaving key i raw for a new separator.
+*/
+template<class Key, class Value, size_t Fanout, class Compare>
+void BTreeMap<Key, Value, Fanout, Compare>::openSlot(Branch* parent, size_t i)
+{
+    for(size_t j = parent->count; j > i; --j)
+    {
+        relocate(parent->key(j), parent->key(j - 1));
+        parent->children[j + 1] = parent->children[j];
+    }
+}
+
+/**
+* Brings child i of parent above its minimum by taking one entry from a
+* sibling that can spare it, or else by merging it with a sibling.
+* Returns the index the child's keys are under afterwards.
+*/
+template<class Key, class Value, size_t Fanout, class Compare>
+size_t BTreeMap<Key, Value, Fanout, Compare>::refillChild(Branch* parent, size_t i)
+{
+    if(i > 0 && !atMinimum(parent->children[i - 1]))
+    {
+        borrowFromLeft(parent, i);
+        return i;
+    }
+    if(i < parent->count && !atMinimum(parent->children[i + 1]))
+    {
+        borrowFromRight(parent, i);
+        return i;
+    }
+    if(i > 0)
+    {
+        mergeChildren(parent, i - 1);
+        return i - 1;
+    }
+    mergeChildren(parent, i);
+    return i;
+}
+
+/**
+* Rotates the last entry of child i - 1 through the separator between
+* them into the front of child i.
+*/
+template<class Key, class Value, size_t Fanout, class Compare>
+void BTreeMap<Key, Value, Fanout, Compare>::borrowFromLeft(Branch* parent, size_t i)
+{
+    NodeBase* child = parent->children[i];
+    NodeBase* sibling = parent->children[i - 1];
+    if(child->leaf)
+    {
+        Leaf* to = static_cast<Leaf*>(child);
+        Leaf* from = static_cast<Leaf*>(sibling);
+        for(size_t j = to->count; j > 0; --j)
+        {
+            relocate(to->item(j), to->item(j - 1));
+        }
+        relocate(to->item(0), from->item(from->count - 1));
+        *parent->key(i - 1) = to->item(0)->first;
+    }
+    else
+    {
+        Branch* to = static_cast<Branch*>(child);
+        Branch* from = static_cast<Branch*>(sibling);
+        to->children[to->count + 1] = to->children[to->count];
+        for(size_t j = to->count; j > 0; --j)
+        {
+            relocate(to->key(j), to->key(j - 1));
+            to->children[j] = to->children[j - 1];
+        }
+        relocate(to->key(0), parent->key(i - 1));
+        to->children[0] = from->children[from->count];
+        relocate(parent->key(i - 1), from->key(from->count - 1));
+    }
+    ++child->count;
+    --sibling->count;
+}
+
+/**
+* Rotates the first entry of child i + 1 through the separator between
+* them onto the end of child i.
+*/
+template<class Key, class Value, size_t Fanout, class Compare>
+void BTreeMap<Key, Value, Fanout, Compare>::borrowFromRight(Branch* parent, size_t i)
+{
+    NodeBase* child = parent->children[i];
+    NodeBase* sibling = parent->children[i + 1];
+    if(child->leaf)
+    {
+        Leaf* to = static_cast<Leaf*>(child);
+        Leaf* from = static_cast<Leaf*>(sibling);
+        relocate(to->item(to->count), from->item(0));
+        for(size_t j = 1; j < from->count; ++j)
+        {
+            relocate(from->item(j - 1), from->item(j));
+        }
+        *parent->key(i) = from->item(0)->first;
+    }
+    else
+    {
+        Branch* to = static_cast<Branch*>(child);
+        Branch* from = static_cast<Branch*>(sibling);
+        relocate(to->key(to->count), parent->key(i));
+        to->children[to->count + 1] = from->children[0];
+        relocate(parent->key(i), from->key(0));
+        for(size_t j = 1; j < from->count; ++j)
+        {
+            relocate(from->key(j - 1), from->key(j));
+        }
+        for(size_t j = 1; j <= from->count; ++j)
+        {
+            from->children[j - 1] = from->children[j];
+        }
+    }
+    ++child->count;
+    --sibling->count;
+}
+
+/**
+* Moves everything in child i + 1 onto the end of child i and frees it,
+* dropping the separator between them. Both children are at their
+* minimum, so the result fits.
+*/
+template<class Key, class Value, size_t Fanout, class Compare>
+void BTreeMap<Key, Value, Fanout, Compare>::mergeChildren(Branch* parent, size_t i)
+{
+    NodeBase* left = parent->children[i];
+    NodeBase* right = parent->children[i + 1];
+    if(left->leaf)
+    {
+        Leaf* to = static_cast<Leaf*>(left);
+        Leaf* from = static_cast<Leaf*>(right);
+        for(size_t j = 0; j < from->count; ++j)
+        {
+            relocate(to->item(to->count + j), from->item(j));
+        }
+        to->count += from->count;
+        to->next = from->next;
+        parent->key(i)->~Key();
+        delete from;
+    }
+    else
+    {
+        Branch* to = static_cast<Branch*>(left);
+        Branch* from = static_cast<Branch*>(right);
+        relocate(to->key(to->count), parent->key(i));
+        for(size_t j = 0; j < from->count; ++j)
+        {
+            relocate(to->key(to->count + 1 + j), from->key(j));
+        }
+        for(size_t j = 0; j <= from->count; ++j)
+        {
+            to->children[to->count + 1 + j] = from->children[j];
+        }
+        to->count += from->count + 1;
+        delete from;
+    }
+    for(size_t j = i + 1; j < parent->count; ++j)
+    {
+        relocate(parent->key(j - 1), parent->key(j));
+        parent->children[j] = parent->children[j + 1];
+    }
+    --parent->count;
+}
+
+/**
+* Moves *from into the raw slot at to and ends its lifetime; keys are
+* const inside items, so this is move-construct then destroy.
+*/
+template<class Key, class Value, size_t Fanout, class Compare>
+template<typename T>
+void BTreeMap<Key, Value, Fanout, Compare>::relocate(T* to, T* from)
+{
+    new (to) T(std::move(*from));
+    from->~T();
+}
+
+/**
+* Frees node and everything below it; the depth is logarithmic, so the
+* recursion stays shallow.
+*/
+template<class Key, class Value, size_t Fanout, class Compare>
+void BTreeMap<Key, Value, Fanout, Compare>::destroyNode(NodeBase* node)
+{
+    if(node->leaf)
+    {
+        Leaf* leaf = static_cast<Leaf*>(node);
+        for(size_t i = 0; i < leaf->count; ++i)
+        {
+            leaf->item(i)->~ItemType();
+        }
+        delete leaf;
+        return;
+    }
+    Branch* branch = static_cast<Branch*>(node);
+    for(size_t i = 0; i < branch->count; ++i)
+    {
+        branch->key(i)->~Key();
+        destroyNode(branch->children[i]);
+    }
+    destroyNode(branch->children[branch->count]);
+    delete branch;
+}
+
+#endif
@@ -0,0 +1,394 @@
+#ifndef INDEX_NODE_H
+#define INDEX_NODE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+// Included from bst.h after the Node class; relies on NodeSelf and EmplaceTag.
+
+/**
+* Storage for the nodes of one tree, owned by its ArenaNodeAllocator.
+* Nodes live in chunks that never move, so a 32-bit index names a node
+* for its whole lifetime: its top bits number the chunk and the rest the
+* slot within it. The first chunk holds FIRST_CHUNK nodes and each one
+* after it twice as many as the last, up to 2^SLOT_BITS, so a small tree
+* takes little memory and a large one few chunks; all 32 hold about 250
+* million nodes. Freed slots are recycled through a free list. Like
+* NodePool, an arena serves a single tree and is not thread safe.
+*
+* Every chunk starts with a copy of the table of chunk addresses, kept
+* up to date as chunks are added. A node's slot gives the start of its
+* own chunk, so resolving a link it holds (see resolve()) costs one load
+* from that table, which the tree's hot nodes share, and some masking.
+*/
+class NodeArena
+{
+public:
+    static const uint32_t INDEX_BITS = 29;   // index width of IndexNode
+
+    NodeArena();
+    ~NodeArena();
+
+    template<typename NodeType>
+    uint32_t allocate();
+    template<typename NodeType>
+    void deallocate(uint32_t index);
+    template<typename NodeType>
+    NodeType* at(uint32_t index) const;
+    void reset();
+
+    template<typename NodeType>
+    static NodeType* resolve(const NodeType* from, uint32_t index);
+
+private:
+    // The arena owns raw memory, so copies would double free it.
+    NodeArena(const NodeArena&);
+    NodeArena& operator=(const NodeArena&);
+
+    static const uint32_t SLOT_BITS = 24;
+    static const uint32_t SLOT_MASK = (1u << SLOT_BITS) - 1;
+    static const uint32_t MAX_CHUNKS = 1u << (INDEX_BITS - SLOT_BITS);
+    static const uint32_t FIRST_CHUNK_BITS = 6;
+    static const uint32_t FIRST_CHUNK = 1u << FIRST_CHUNK_BITS;
+    static const uint32_t NO_SLOT = 0xFFFFFFFF;
+
+    // the table is padded so that the nodes after it stay aligned
+    static const size_t HEADER_SIZE = (MAX_CHUNKS * sizeof(char*) + alignof(std::max_align_t) - 1)
+                                      / alignof(std::max_align_t) * alignof(std::max_align_t);
+
+    static uint32_t chunkSize(uint32_t chunk);
+
+    char* chunks_[MAX_CHUNKS];   // first node of each chunk, its table before it
+    uint32_t chunkCount_;
+    uint32_t next_;       // next index never handed out since reset()
+    uint32_t end_;        // one past the last slot of next_'s chunk; 0 before any
+    uint32_t freeList_;   // most recently freed slot, or NO_SLOT
+};
+
+inline NodeArena::NodeArena() :
+    chunkCount_(0),
+    next_(0),
+    end_(0),
+    freeList_(NO_SLOT)
+{
+
+}
+
+inline NodeArena::~NodeArena()
+{
+    for(uint32_t i = 0; i < chunkCount_; ++i)
+    {
+        ::operator delete(chunks_[i] - HEADER_SIZE);
+    }
+}
+
+inline uint32_t NodeArena::chunkSize(uint32_t chunk)
+{
+    return chunk < SLOT_BITS - FIRST_CHUNK_BITS ? FIRST_CHUNK << chunk : 1u << SLOT_BITS;
+}
+
+/**
+* Returns the index of a free slot. Once every slot of the last chunk in
+* use has been handed out, moves on to the next chunk, allocating it
+* (twice the size of the one before) unless reset() left it behind.
+*/
+template<typename NodeType>
+uint32_t NodeArena::allocate()
+{
+    static_assert(sizeof(NodeType) >= sizeof(uint32_t), "a free slot holds a uint32_t");
+    static_assert(alignof(NodeType) <= alignof(std::max_align_t), "over-aligned nodes are not supported");
+    if(freeList_ != NO_SLOT)
+    {
+        uint32_t index = freeList_;
+        // a free slot holds the index of the next free slot
+        std::memcpy(&freeList_, static_cast<void*>(at<NodeType>(index)), sizeof(uint32_t));
+        return index;
+    }
+    if(next_ == end_)
+    {
+        uint32_t chunk = end_ == 0 ? 0 : ((end_ - 1) >> SLOT_BITS) + 1;
+        if(chunk == MAX_CHUNKS)
+        {
+            throw std::length_error("NodeArena is full");
+        }
+        if(chunk == chunkCount_)
+        {
+            size_t bytes = HEADER_SIZE + sizeof(NodeType) * static_cast<size_t>(chunkSize(chunk));
+            chunks_[chunkCount_++] = static_cast<char*>(::operator new(bytes)) + HEADER_SIZE;
+            for(uint32_t i = 0; i < chunkCount_; ++i)
+            {
+                std::memcpy(chunks_[i] - HEADER_SIZE, chunks_, chunkCount_ * sizeof(char*));
+            }
+        }
+        next_ = chunk << SLOT_BITS;
+        end_ = next_ + chunkSize(chunk);
+    }
+    return next_++;
+}
+
+/**
+* Returns a slot whose node has already been destroyed to the free list.
+*/
+template<typename NodeType>
+void NodeArena::deallocate(uint32_t index)
+{
+    std::memcpy(static_cast<void*>(at<NodeType>(index)), &freeList_, sizeof(uint32_t));
+    freeList_ = index;
+}
+
+template<typename NodeType>
+NodeType* NodeArena::at(uint32_t index) const
+{
+    return reinterpret_cast<NodeType*>(chunks_[index >> SLOT_BITS]) + (index & SLOT_MASK);
+}
+
+/**
+* Marks every slot as unused, keeping the chunks. The caller is
+* responsible for having run any destructors that matter.
+*/
+inline void NodeArena::reset()
+{
+    next_ = 0;
+    end_ = 0;
+    freeList_ = NO_SLOT;
+}
+
+/**
+* The node at index in the arena holding from: from's slot leads back to
+* the start of its chunk, and the table in front of that to index's.
+*/
+template<typename NodeType>
+NodeType* NodeArena::resolve(const NodeType* from, uint32_t index)
+{
+    const char* first = reinterpret_cast<const char*>(from - (from->getIndex() & SLOT_MASK));
+    char* const* table = reinterpret_cast<char* const*>(first - HEADER_SIZE);
+    return reinterpret_cast<NodeType*>(table[index >> SLOT_BITS]) + (index & SLOT_MASK);
+}
+
+/**
+* A Node whose parent/left/right links are 32-bit arena indices instead
+* of pointers into the NodeArena of their tree. The interface matches
+* Node, so the same tree algorithms run on either. Nodes must be created
+* by ArenaNodeAllocator, which records each node's own index; the top three bits of that index word
+* are spare and are used by IndexAVLNode to hold the balance.
+*/
+template <typename Key, typename Value, typename Derived = void>
+class IndexNode
+{
+public:
+    typedef typename NodeSelf<IndexNode, Derived>::type NodeType;
+
+    IndexNode(const Key& key, const Value& value, NodeType* parent);
+    template<typename... Args>
+    IndexNode(EmplaceTag, NodeType* parent, Args&&... args);
+
+    const std::pair<const Key, Value>& getItem() const;
+    std::pair<const Key, Value>& getItem();
+    const Key& getKey() const;
+    const Value& getValue() const;
+    Value& getValue();
+
+    NodeType* getParent() const;
+    NodeType* getLeft() const;
+    NodeType* getRight() const;
+
+    void setParent(NodeType* parent);
+    void setLeft(NodeType* left);
+    void setRight(NodeType* right);
+    void setValue(const Value &value);
+
+    uint32_t getIndex() const;
+    void setIndex(uint32_t index);
+
+protected:
+    static const uint32_t NIL = 0xFFFFFFFF;
+    static const uint32_t INDEX_MASK = (1u << NodeArena::INDEX_BITS) - 1;
+
+    static uint32_t indexOf(const NodeType* node);
+    NodeType* nodeAt(uint32_t index) const;
+
+    std::pair<const Key, Value> item_;
+    uint32_t parent_;
+    uint32_t left_;
+    uint32_t right_;
+    uint32_t self_;   // own index in the low bits, spare bits above
+};
+
+template<typename Key, typename Value, typename Derived>
+IndexNode<Key, Value, Derived>::IndexNode(const Key& key, const Value& value, NodeType* parent) :
+    item_(key, value),
+    parent_(indexOf(parent)),
+    left_(NIL),
+    right_(NIL),
+    self_(0)
+{
+
+}
+
+template<typename Key, typename Value, typename Derived>
+template<typename... Args>
+IndexNode<Key, Value, Derived>::IndexNode(EmplaceTag, NodeType* parent, Args&&... args) :
+    item_(std::forward<Args>(args)...),
+    parent_(indexOf(parent)),
+    left_(NIL),
+    right_(NIL),
+    self_(0)
+{
+
+}
+
+template<typename Key, typename Value, typename Derived>
+const std::pair<const Key, Value>& IndexNode<Key, Value, Derived>::getItem() const
+{
+    return item_;
+}
+
+template<typename Key, typename Value, typename Derived>
+std::pair<const Key, Value>& IndexNode<Key, Value, Derived>::getItem()
+{
+    return item_;
+}
+
+template<typename Key, typename Value, typename Derived>
+const Key& IndexNode<Key, Value, Derived>::getKey() const
+{
+    return item_.first;
+}
+
+template<typename Key, typename Value, typename Derived>
+const Value& IndexNode<Key, Value, Derived>::getValue() const
+{
+    return item_.second;
+}
+
+template<typename Key, typename Value, typename Derived>
+Value& IndexNode<Key, Value, Derived>::getValue()
+{
+    return item_.second;
+}
+
+template<typename Key, typename Value, typename Derived>
+typename IndexNode<Key, Value, Derived>::NodeType* IndexNode<Key, Value, Derived>::getParent() const
+{
+    return nodeAt(parent_);
+}
+
+template<typename Key, typename Value, typename Derived>
+typename IndexNode<Key, Value, Derived>::NodeType* IndexNode<Key, Value, Derived>::getLeft() const
+{
+    return nodeAt(left_);
+}
+
+template<typename Key, typename Value, typename Derived>
+typename IndexNode<Key, Value, Derived>::NodeType* IndexNode<Key, Value, Derived>::getRight() const
+{
+    return nodeAt(right_);
+}
+
+template<typename Key, typename Value, typename Derived>
+void IndexNode<Key, Value, Derived>::setParent(NodeType* parent)
+{
+    parent_ = indexOf(parent);
+}
+
+template<typename Key, typename Value, typename Derived>
+void IndexNode<Key, Value, Derived>::setLeft(NodeType* left)
+{
+    left_ = indexOf(left);
+}
+
+template<typename Key, typename Value, typename Derived>
+void IndexNode<Key, Value, Derived>::setRight(NodeType* right)
+{
+    right_ = indexOf(right);
+}
+
+template<typename Key, typename Value, typename Derived>
+void IndexNode<Key, Value, Derived>::setValue(const Value& value)
+{
+    item_.second = value;
+}
+
+/**
+* The node's own slot in its tree's NodeArena.
+*/
+template<typename Key, typename Value, typename Derived>
+uint32_t IndexNode<Key, Value, Derived>::getIndex() const
+{
+    return self_ & INDEX_MASK;
+}
+
+template<typename Key, typename Value, typename Derived>
+void IndexNode<Key, Value, Derived>::setIndex(uint32_t index)
+{
+    self_ = (self_ & ~INDEX_MASK) | index;
+}
+
+template<typename Key, typename Value, typename Derived>
+uint32_t IndexNode<Key, Value, Derived>::indexOf(const NodeType* node)
+{
+    return node == NULL ? NIL : node->getIndex();
+}
+
+/**
+* Resolves a link through the arena this node lives in; linked nodes
+* always share it.
+*/
+template<typename Key, typename Value, typename Derived>
+typename IndexNode<Key, Value, Derived>::NodeType* IndexNode<Key, Value, Derived>::nodeAt(uint32_t index) const
+{
+    if(index == NIL) return NULL;
+    return NodeArena::resolve(static_cast<const NodeType*>(this), index);
+}
+
+/**
+* The allocation policy for IndexNode trees: nodes are placed in the
+* allocator's own NodeArena and told their own index. Each tree has its
+* own arena, so reset() reclaims every node at once, and the chunks are
+* returned when the tree is destroyed.
+*/
+class ArenaNodeAllocator
+{
+public:
+    template<typename NodeType, typename... Args>
+    NodeType* create(Args&&... args)
+    {
+        uint32_t index = arena_.allocate<NodeType>();
+        NodeType* node;
+        try
+        {
+            node = new (arena_.at<NodeType>(index)) NodeType(std::forward<Args>(args)...);
+        }
+        catch(...)
+        {
+            arena_.deallocate<NodeType>(index);
+            throw;
+        }
+        node->setIndex(index);
+        return node;
+    }
+
+    template<typename NodeType>
+    void destroy(NodeType* node)
+    {
+        uint32_t index = node->getIndex();
+        node->~NodeType();
+        arena_.deallocate<NodeType>(index);
+    }
+
+    bool reset()
+    {
+        arena_.reset();
+        return true;
+    }
+
+private:
+    NodeArena arena_;
+};
+
+#endif
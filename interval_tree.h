@@ -0,0 +1,118 @@
+#ifndef INTERVAL_TREE_H
+#define INTERVAL_TREE_H
+
+#include <limits>
+#include "avlbst.h"
+
+/**
+* Reads the end of the interval [key, end) stored under key. By default
+* the value is the end itself; values that carry more than the end
+* (e.g. an allocation record) supply their own EndOf with the same
+* static get().
+*/
+template <typename Key, typename Value>
+struct IntervalEnd
+{
+    static const Key& get(const Value& value) { return value; }
+};
+
+/**
+* The largest interval end in a subtree, cached in every node of an
+* IntervalTree. identity() is only needed by rangeAggregate().
+*/
+template <typename Key, typename Value, typename EndOf>
+struct MaxEndMonoid
+{
+    typedef Key summary_type;
+    static Key identity() { return std::numeric_limits<Key>::lowest(); }
+    static Key of(const Key&, const Value& value) { return EndOf::get(value); }
+    static Key combine(const Key& a, const Key& b) { return a < b ? b : a; }
+};
+
+/**
+* An AVLTree of half-open intervals [start, end), keyed by start, that
+* finds the intervals containing a point or overlapping a range without
+* visiting the rest. Every node caches the largest end in its subtree
+* (an AggregateAVLNode under MaxEndMonoid), so subtrees that end before
+* the query are skipped, as are all starts past it. Starts are unique,
+* as keys are in every tree here; ends are compared with operator<.
+*
+* A query reporting k intervals visits the nodes on the paths from the
+* root to those k, plus one search path, which is
+* O(log n + k log(n/k + 1)): close to O(log n + k) when the matches are
+* many or sit together, but O(k log n) when a few are scattered, since
+* each can cost a descent of its own. Meeting O(log n + k) in every case
+* would take another structure, such as a centered interval tree or a
+* priority search tree, rather than an augmented AVLTree.
+*
+* Keep ends current by changing them only through insert() or
+* insert_or_assign(), which repair the cached maxima.
+*/
+template <typename Key, typename Value = Key, typename EndOf = IntervalEnd<Key, Value> >
+class IntervalTree : public AVLTree<Key, Value, std::less<Key>, NewDeleteNodeAllocator,
+                                    AggregateAVLNode<Key, Value, MaxEndMonoid<Key, Value, EndOf> > >
+{
+public:
+    typedef AggregateAVLNode<Key, Value, MaxEndMonoid<Key, Value, EndOf> > NodeType;
+    typedef typename AVLTree<Key, Value, std::less<Key>, NewDeleteNodeAllocator, NodeType>::iterator iterator;
+
+    // Both write an iterator per match to out, in order of start, and
+    // return out advanced past them; see above for the cost.
+    template<typename OutputIt>
+    OutputIt stab(const Key& point, OutputIt out) const;              // start <= point < end
+    template<typename OutputIt>
+    OutputIt overlapping(const Key& lo, const Key& hi, OutputIt out) const; // meets [lo, hi)
+
+private:
+    template<typename OutputIt>
+    static void collect(NodeType* node, const Key& lo, const Key& hi, bool includeHi, OutputIt& out);
+};
+
+template<class Key, class Value, class EndOf>
+template<typename OutputIt>
+OutputIt IntervalTree<Key, Value, EndOf>::stab(const Key& point, OutputIt out) const
+{
+    collect(this->root_, point, point, true, out);
+    return out;
+}
+
+/**
+* An empty query range (hi <= lo) meets nothing.
+*/
+template<class Key, class Value, class EndOf>
+template<typename OutputIt>
+OutputIt IntervalTree<Key, Value, EndOf>::overlapping(const Key& lo, const Key& hi, OutputIt out) const
+{
+    if(lo < hi)
+    {
+        collect(this->root_, lo, hi, false, out);
+    }
+    return out;
+}
+
+/**
+* Visits the subtree at node in order, reporting every interval with
+* start before hi (or at it, when includeHi) and end after lo. A subtree
+* whose largest end is not after lo holds no match; once a start reaches
+* hi, neither does anything to its right.
+*/
+template<class Key, class Value, class EndOf>
+template<typename OutputIt>
+void IntervalTree<Key, Value, EndOf>::collect(NodeType* node, const Key& lo, const Key& hi, bool includeHi, OutputIt& out)
+{
+    while(node != NULL && lo < node->getSummary())
+    {
+        collect(node->getLeft(), lo, hi, includeHi, out);
+        if(includeHi ? hi < node->getKey() : !(node->getKey() < hi))
+        {
+            return;
+        }
+        if(lo < EndOf::get(node->getValue()))
+        {
+            *out++ = IntervalTree::iteratorAt(node);
+        }
+        node = node->getRight();
+    }
+}
+
+#endif
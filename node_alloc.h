@@ -0,0 +1,257 @@
+#ifndef NODE_ALLOC_H
+#define NODE_ALLOC_H
+
+#include <algorithm>
+#include <cstddef>
+#include <new>
+#include <utility>
+#include <vector>
+
+/**
+* Node allocation policies for the search trees.
+*
+* A policy hands out and reclaims the nodes of a single tree:
+*
+*   template<typename NodeType, typename... Args>
+*   NodeType* create(Args&&... args);     // construct a node
+*   template<typename NodeType>
+*   void destroy(NodeType* node);         // destroy and reclaim one node
+*   bool reset();                         // reclaim every node at once
+*
+* reset() returns false when the policy cannot reclaim nodes in bulk, in
+* which case the tree falls back to destroying its nodes one at a time.
+*
+* Policies that can move a whole tree into one block (NodePool) also offer
+*
+*   template<typename NodeType>
+*   NodeType* beginCompact(size_t count); // raw storage for count nodes
+*   void endCompact(void* block, size_t count); // block replaces all storage
+*   void abortCompact(void* block);       // give the block back unused
+*
+* which BinarySearchTree::compact() uses.
+*/
+
+/**
+* The default policy: every node is its own new/delete.
+*/
+class NewDeleteNodeAllocator
+{
+public:
+    template<typename NodeType, typename... Args>
+    NodeType* create(Args&&... args)
+    {
+        return new NodeType(std::forward<Args>(args)...);
+    }
+
+    template<typename NodeType>
+    void destroy(NodeType* node)
+    {
+        delete node;
+    }
+
+    bool reset()
+    {
+        return false;
+    }
+};
+
+/**
+* A slab allocator that carves nodes out of contiguous chunks of
+* NodesPerChunk nodes each. Removed nodes are recycled through a free
+* list, and reset() makes every chunk available again in O(chunks)
+* without visiting the nodes. Chunks are kept for reuse until release()
+* or destruction.
+*
+* A pool serves a single tree, and so a single node type. It is not
+* thread safe.
+*/
+template<size_t NodesPerChunk = 512>
+class NodePool
+{
+public:
+    NodePool();
+    ~NodePool();
+
+    template<typename NodeType, typename... Args>
+    NodeType* create(Args&&... args);
+    template<typename NodeType>
+    void destroy(NodeType* node);
+    bool reset();
+    void release();
+
+    template<typename NodeType>
+    NodeType* beginCompact(size_t count);
+    void endCompact(void* block, size_t count);
+    void abortCompact(void* block);
+
+private:
+    // The pool owns raw memory, so copies would double free it.
+    NodePool(const NodePool&);
+    NodePool& operator=(const NodePool&);
+
+    void* allocateBlock(size_t size, size_t align);
+
+    struct FreeBlock
+    {
+        FreeBlock* next;
+    };
+
+    std::vector<char*> chunks_;
+    std::vector<size_t> capacities_;   // blocks per chunk
+    size_t blockSize_;
+    size_t chunkIndex_;  // chunk currently handing out fresh blocks
+    size_t nextBlock_;   // first never-used block in that chunk
+    FreeBlock* freeList_;
+};
+
+template<size_t NodesPerChunk>
+NodePool<NodesPerChunk>::NodePool() :
+    blockSize_(0),
+    chunkIndex_(0),
+    nextBlock_(0),
+    freeList_(NULL)
+{
+
+}
+
+template<size_t NodesPerChunk>
+NodePool<NodesPerChunk>::~NodePool()
+{
+    release();
+}
+
+/**
+* Constructs a node in a recycled block if one is available, otherwise
+* in the next unused block of the current chunk.
+*/
+template<size_t NodesPerChunk>
+template<typename NodeType, typename... Args>
+NodeType* NodePool<NodesPerChunk>::create(Args&&... args)
+{
+    void* block = allocateBlock(sizeof(NodeType), alignof(NodeType));
+    try
+    {
+        return new (block) NodeType(std::forward<Args>(args)...);
+    }
+    catch(...)
+    {
+        FreeBlock* freed = static_cast<FreeBlock*>(block);
+        freed->next = freeList_;
+        freeList_ = freed;
+        throw;
+    }
+}
+
+/**
+* Destroys the node and pushes its block onto the free list.
+*/
+template<size_t NodesPerChunk>
+template<typename NodeType>
+void NodePool<NodesPerChunk>::destroy(NodeType* node)
+{
+    node->~NodeType();
+    FreeBlock* freed = reinterpret_cast<FreeBlock*>(node);
+    freed->next = freeList_;
+    freeList_ = freed;
+}
+
+/**
+* Marks every block of every chunk as unused. The caller is responsible
+* for having run any destructors that matter.
+*/
+template<size_t NodesPerChunk>
+bool NodePool<NodesPerChunk>::reset()
+{
+    freeList_ = NULL;
+    chunkIndex_ = 0;
+    nextBlock_ = 0;
+    return true;
+}
+
+/**
+* Returns all chunks to the system. Only valid once the pool's nodes
+* are no longer in use, e.g. after the tree has been cleared.
+*/
+template<size_t NodesPerChunk>
+void NodePool<NodesPerChunk>::release()
+{
+    for(size_t i = 0; i < chunks_.size(); ++i)
+    {
+        ::operator delete(chunks_[i]);
+    }
+    chunks_.clear();
+    capacities_.clear();
+    blockSize_ = 0;
+    reset();
+}
+
+/**
+* Returns uninitialized storage for count nodes in one contiguous block,
+* kept apart from the pool's chunks until endCompact() or abortCompact().
+*/
+template<size_t NodesPerChunk>
+template<typename NodeType>
+NodeType* NodePool<NodesPerChunk>::beginCompact(size_t count)
+{
+    if(blockSize_ == 0)
+    {
+        blockSize_ = std::max(sizeof(NodeType), sizeof(FreeBlock));
+        blockSize_ = (blockSize_ + alignof(NodeType) - 1) / alignof(NodeType) * alignof(NodeType);
+    }
+    return reinterpret_cast<NodeType*>(::operator new(blockSize_ * count));
+}
+
+/**
+* Makes the fully used block from beginCompact() the pool's only chunk.
+* Every node in the old chunks must already be destroyed.
+*/
+template<size_t NodesPerChunk>
+void NodePool<NodesPerChunk>::endCompact(void* block, size_t count)
+{
+    size_t blockSize = blockSize_;
+    release();
+    chunks_.push_back(static_cast<char*>(block));
+    capacities_.push_back(count);
+    blockSize_ = blockSize;
+    nextBlock_ = count;
+}
+
+template<size_t NodesPerChunk>
+void NodePool<NodesPerChunk>::abortCompact(void* block)
+{
+    ::operator delete(block);
+}
+
+template<size_t NodesPerChunk>
+void* NodePool<NodesPerChunk>::allocateBlock(size_t size, size_t align)
+{
+    if(freeList_ != NULL)
+    {
+        FreeBlock* block = freeList_;
+        freeList_ = block->next;
+        return block;
+    }
+    if(blockSize_ == 0)
+    {
+        // round up so that every block in a chunk stays aligned
+        blockSize_ = std::max(size, sizeof(FreeBlock));
+        blockSize_ = (blockSize_ + align - 1) / align * align;
+    }
+    if(chunks_.empty() || nextBlock_ == capacities_[chunkIndex_])
+    {
+        if(chunks_.empty() || chunkIndex_ + 1 == chunks_.size())
+        {
+            chunks_.push_back(static_cast<char*>(::operator new(blockSize_ * NodesPerChunk)));
+            capacities_.push_back(NodesPerChunk);
+            chunkIndex_ = chunks_.size() - 1;
+        }
+        else
+        {
+            ++chunkIndex_;
+        }
+        nextBlock_ = 0;
+    }
+    return chunks_[chunkIndex_] + blockSize_ * nextBlock_++;
+}
+
+#endif
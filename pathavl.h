@@ -0,0 +1,738 @@
+#ifndef PATHAVL_H
+#define PATHAVL_H
+
+#include <iostream>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include "bst.h"
+
+/**
+* A node for PathAVLTree: an AVL node with no parent pointer. The tree
+* records the path from the root while it descends instead.
+*/
+template <typename Key, typename Value>
+class PathAVLNode
+{
+public:
+    PathAVLNode(const Key& key, const Value& value);
+
+    const std::pair<const Key, Value>& getItem() const;
+    std::pair<const Key, Value>& getItem();
+    const Key& getKey() const;
+    const Value& getValue() const;
+    Value& getValue();
+
+    PathAVLNode<Key, Value>* getLeft() const;
+    PathAVLNode<Key, Value>* getRight() const;
+    PathAVLNode<Key, Value>* getChild(int dir) const;
+
+    void setLeft(PathAVLNode<Key, Value>* left);
+    void setRight(PathAVLNode<Key, Value>* right);
+    void setChild(int dir, PathAVLNode<Key, Value>* child);
+    void setValue(const Value &value);
+
+    int8_t getBalance () const;
+    void setBalance (int8_t balance);
+
+protected:
+    std::pair<const Key, Value> item_;
+    PathAVLNode<Key, Value>* left_;
+    PathAVLNode<Key, Value>* right_;
+    int8_t balance_;
+};
+
+/*
+  -------------------------------------------------
+  Begin implementations for the PathAVLNode class.
+  -------------------------------------------------
+*/
+
+template<typename Key, typename Value>
+PathAVLNode<Key, Value>::PathAVLNode(const Key& key, const Value& value) :
+    item_(key, value),
+    left_(NULL),
+    right_(NULL),
+    balance_(0)
+{
+
+}
+
+template<typename Key, typename Value>
+const std::pair<const Key, Value>& PathAVLNode<Key, Value>::getItem() const
+{
+    return item_;
+}
+
+template<typename Key, typename Value>
+std::pair<const Key, Value>& PathAVLNode<Key, Value>::getItem()
+{
+    return item_;
+}
+
+template<typename Key, typename Value>
+const Key& PathAVLNode<Key, Value>::getKey() const
+{
+    return item_.first;
+}
+
+template<typename Key, typename Value>
+const Value& PathAVLNode<Key, Value>::getValue() const
+{
+    return item_.second;
+}
+
+template<typename Key, typename Value>
+Value& PathAVLNode<Key, Value>::getValue()
+{
+    return item_.second;
+}
+
+template<typename Key, typename Value>
+PathAVLNode<Key, Value>* PathAVLNode<Key, Value>::getLeft() const
+{
+    return left_;
+}
+
+template<typename Key, typename Value>
+PathAVLNode<Key, Value>* PathAVLNode<Key, Value>::getRight() const
+{
+    return right_;
+}
+
+/**
+* The left child for dir < 0, the right child otherwise.
+*/
+template<typename Key, typename Value>
+PathAVLNode<Key, Value>* PathAVLNode<Key, Value>::getChild(int dir) const
+{
+    return dir < 0 ? left_ : right_;
+}
+
+template<typename Key, typename Value>
+void PathAVLNode<Key, Value>::setLeft(PathAVLNode<Key, Value>* left)
+{
+    left_ = left;
+}
+
+template<typename Key, typename Value>
+void PathAVLNode<Key, Value>::setRight(PathAVLNode<Key, Value>* right)
+{
+    right_ = right;
+}
+
+template<typename Key, typename Value>
+void PathAVLNode<Key, Value>::setChild(int dir, PathAVLNode<Key, Value>* child)
+{
+    if(dir < 0) left_ = child;
+    else right_ = child;
+}
+
+template<typename Key, typename Value>
+void PathAVLNode<Key, Value>::setValue(const Value& value)
+{
+    item_.second = value;
+}
+
+template<typename Key, typename Value>
+int8_t PathAVLNode<Key, Value>::getBalance() const
+{
+    return balance_;
+}
+
+template<typename Key, typename Value>
+void PathAVLNode<Key, Value>::setBalance(int8_t balance)
+{
+    balance_ = balance;
+}
+
+/*
+  -----------------------------------------------
+  End implementations for the PathAVLNode class.
+  -----------------------------------------------
+*/
+
+/**
+* An AVL tree whose nodes have no parent pointer. insert() and remove()
+* record their descent on a fixed-size stack and retrace it to rebalance,
+* and the iterator keeps its own stack of pending ancestors. This saves a
+* pointer per node at the cost of larger iterators; any insert or remove
+* invalidates all iterators.
+*
+* The shared BinarySearchTree algorithms all follow parent links, so this
+* is a separate implementation. It orders keys by Compare and searches
+* with one KeyOrder<Compare> call per level, as the other trees do, and
+* it takes the same NodeAlloc policies, except ArenaNodeAllocator, which
+* needs an IndexNode. Of the BinarySearchTree interface it provides
+* insert() (returning nothing), remove(), clear(), find(), operator[],
+* begin()/end(), lower_bound(), upper_bound(), size(), empty(),
+* key_comp() and isBalanced(). It does not provide assign() or the range
+* constructor, insertBatch(), hinted insert, emplace(), try_emplace(),
+* insert_or_assign(), last(), equal_range(), floor(), ceiling(), order
+* statistics, aggregates, transparent lookup, compact(), rebalance(), or
+* AVLTree's split(), join(), range erase and set operations.
+*/
+template <typename Key, typename Value, typename Compare = std::less<Key>,
+          typename NodeAlloc = NewDeleteNodeAllocator>
+class PathAVLTree
+{
+public:
+    typedef PathAVLNode<Key, Value> NodeType;
+    typedef Compare key_compare;
+
+    // An AVL tree of height 64 holds more than 2^44 nodes.
+    static const int MAX_HEIGHT = 64;
+
+    PathAVLTree();
+    explicit PathAVLTree(const Compare& comp);
+    ~PathAVLTree();
+    void insert(const std::pair<const Key, Value>& keyValuePair);
+    void remove(const Key& key);
+    void clear();
+    bool isBalanced() const;
+    bool empty() const;
+    size_t size() const;
+
+    /**
+    * An in-order iterator holding the path of ancestors still to visit.
+    */
+    class iterator
+    {
+    public:
+        iterator();
+
+        std::pair<const Key,Value>& operator*() const;
+        std::pair<const Key,Value>* operator->() const;
+
+        bool operator==(const iterator& rhs) const;
+        bool operator!=(const iterator& rhs) const;
+
+        iterator& operator++();
+
+    protected:
+        friend class PathAVLTree<Key, Value, Compare, NodeAlloc>;
+        void pushLeftSpine(NodeType* node);
+        NodeType* current() const;
+
+        NodeType* stack_[MAX_HEIGHT];
+        int depth_;
+    };
+
+    iterator begin() const;
+    iterator end() const;
+    iterator find(const Key& key) const;
+    Value& operator[](const Key& key);
+    Value const & operator[](const Key& key) const;
+    Compare key_comp() const;
+    iterator lower_bound(const Key& key) const; // first key >= key
+    iterator upper_bound(const Key& key) const; // first key > key
+
+protected:
+    NodeType* internalFind(const Key& key) const;
+    int compareKeys(const Key& a, const Key& b) const;
+    iterator bound(const Key& key, bool orEqual) const;
+    static NodeType* rotate(NodeType* axis, int dir);
+    static NodeType* rebalance(NodeType* node);
+    void replaceChild(NodeType** path, int* dirs, int depth, NodeType* child);
+    int calculateHeightIfBalanced(NodeType* root, bool* unbalancedbool) const;
+    void postOrderTraveralClear(NodeType* curr);
+
+    NodeType* root_;
+    NodeAlloc alloc_;
+    Compare comp_;
+    size_t size_;
+};
+
+/*
+--------------------------------------------------------
+Begin implementations for the PathAVLTree::iterator class.
+--------------------------------------------------------
+*/
+
+template<class Key, class Value, class Compare, class NodeAlloc>
+PathAVLTree<Key, Value, Compare, NodeAlloc>::iterator::iterator() :
+    depth_(0)
+{
+
+}
+
+template<class Key, class Value, class Compare, class NodeAlloc>
+std::pair<const Key,Value>&
+PathAVLTree<Key, Value, Compare, NodeAlloc>::iterator::operator*() const
+{
+    return current()->getItem();
+}
+
+template<class Key, class Value, class Compare, class NodeAlloc>
+std::pair<const Key,Value>*
+PathAVLTree<Key, Value, Compare, NodeAlloc>::iterator::operator->() const
+{
+    return &(current()->getItem());
+}
+
+template<class Key, class Value, class Compare, class NodeAlloc>
+bool
+PathAVLTree<Key, Value, Compare, NodeAlloc>::iterator::operator==(const iterator& rhs) const
+{
+    return current() == rhs.current();
+}
+
+template<class Key, class Value, class Compare, class NodeAlloc>
+bool
+PathAVLTree<Key, Value, Compare, NodeAlloc>::iterator::operator!=(const iterator& rhs) const
+{
+    return current() != rhs.current();
+}
+
+/**
+* The top of the stack is the current node; below it are the ancestors
+* whose left subtree we are in, i.e. the nodes that come next in order.
+*/
+template<class Key, class Value, class Compare, class NodeAlloc>
+typename PathAVLTree<Key, Value, Compare, NodeAlloc>::iterator&
+PathAVLTree<Key, Value, Compare, NodeAlloc>::iterator::operator++()
+{
+    NodeType* done = stack_[--depth_];
+    pushLeftSpine(done->getRight());
+    return *this;
+}
+
+template<class Key, class Value, class Compare, class NodeAlloc>
+void PathAVLTree<Key, Value, Compare, NodeAlloc>::iterator::pushLeftSpine(NodeType* node)
+{
+    while(node != NULL)
+    {
+        stack_[depth_++] = node;
+        node = node->getLeft();
+    }
+}
+
+template<class Key, class Value, class Compare, class NodeAlloc>
+typename PathAVLTree<Key, Value, Compare, NodeAlloc>::NodeType*
+PathAVLTree<Key, Value, Compare, NodeAlloc>::iterator::current() const
+{
+    return depth_ == 0 ? NULL : stack_[depth_ - 1];
+}
+
+/*
+------------------------------------------------------
+End implementations for the PathAVLTree::iterator class.
+------------------------------------------------------
+*/
+
+template<class Key, class Value, class Compare, class NodeAlloc>
+PathAVLTree<Key, Value, Compare, NodeAlloc>::PathAVLTree() :
+    root_(NULL),
+    size_(0)
+{
+
+}
+
+template<class Key, class Value, class Compare, class NodeAlloc>
+PathAVLTree<Key, Value, Compare, NodeAlloc>::PathAVLTree(const Compare& comp) :
+    root_(NULL),
+    comp_(comp),
+    size_(0)
+{
+
+}
+
+template<class Key, class Value, class Compare, class NodeAlloc>
+PathAVLTree<Key, Value, Compare, NodeAlloc>::~PathAVLTree()
+{
+    clear();
+}
+
+template<class Key, class Value, class Compare, class NodeAlloc>
+bool PathAVLTree<Key, Value, Compare, NodeAlloc>::empty() const
+{
+    return root_ == NULL;
+}
+
+template<class Key, class Value, class Compare, class NodeAlloc>
+size_t PathAVLTree<Key, Value, Compare, NodeAlloc>::size() const
+{
+    return size_;
+}
+
+template<class Key, class Value, class Compare, class NodeAlloc>
+Compare PathAVLTree<Key, Value, Compare, NodeAlloc>::key_comp() const
+{
+    return comp_;
+}
+
+template<class Key, class Value, class Compare, class NodeAlloc>
+typename PathAVLTree<Key, Value, Compare, NodeAlloc>::iterator
+PathAVLTree<Key, Value, Compare, NodeAlloc>::begin() const
+{
+    iterator it;
+    it.pushLeftSpine(root_);
+    return it;
+}
+
+template<class Key, class Value, class Compare, class NodeAlloc>
+typename PathAVLTree<Key, Value, Compare, NodeAlloc>::iterator
+PathAVLTree<Key, Value, Compare, NodeAlloc>::end() const
+{
+    return iterator();
+}
+
+/**
+* Returns an iterator to the item with the given key, or end(). The
+* descent keeps every node where it turned left, which is exactly the
+* stack the iterator needs to continue from the found node.
+*/
+template<class Key, class Value, class Compare, class NodeAlloc>
+typename PathAVLTree<Key, Value, Compare, NodeAlloc>::iterator
+PathAVLTree<Key, Value, Compare, NodeAlloc>::find(const Key& key) const
+{
+    iterator it;
+    NodeType* current = root_;
+    while(current != NULL)
+    {
+        int order = compareKeys(key, current->getKey());
+        if(order < 0)
+        {
+            it.stack_[it.depth_++] = current;
+            current = current->getLeft();
+        }
+        else if(order > 0)
+        {
+            current = current->getRight();
+        }
+        else
+        {
+            it.stack_[it.depth_++] = current;
+            return it;
+        }
+    }
+    return end();
+}
+
+template<class Key, class Value, class Compare, class NodeAlloc>
+typename PathAVLTree<Key, Value, Compare, NodeAlloc>::iterator
+PathAVLTree<Key, Value, Compare, NodeAlloc>::lower_bound(const Key& key) const
+{
+    return bound(key, true);
+}
+
+template<class Key, class Value, class Compare, class NodeAlloc>
+typename PathAVLTree<Key, Value, Compare, NodeAlloc>::iterator
+PathAVLTree<Key, Value, Compare, NodeAlloc>::upper_bound(const Key& key) const
+{
+    return bound(key, false);
+}
+
+/**
+* The first key above key (or equal to it when orEqual). As in find(),
+* the nodes where the descent turns left are the iterator's stack, and
+* the last of them is the answer.
+*/
+template<class Key, class Value, class Compare, class NodeAlloc>
+typename PathAVLTree<Key, Value, Compare, NodeAlloc>::iterator
+PathAVLTree<Key, Value, Compare, NodeAlloc>::bound(const Key& key, bool orEqual) const
+{
+    iterator it;
+    NodeType* current = root_;
+    while(current != NULL)
+    {
+        int order = compareKeys(key, current->getKey());
+        if(order < 0 || (order == 0 && orEqual))
+        {
+            it.stack_[it.depth_++] = current;
+            current = current->getLeft();
+        }
+        else
+        {
+            current = current->getRight();
+        }
+    }
+    return it;
+}
+
+/**
+ * @precondition The key exists in the map
+ * Returns the value associated with the key
+ */
+template<class Key, class Value, class Compare, class NodeAlloc>
+Value& PathAVLTree<Key, Value, Compare, NodeAlloc>::operator[](const Key& key)
+{
+    NodeType* curr = internalFind(key);
+    if(curr == NULL) throw std::out_of_range("Invalid key");
+    return curr->getValue();
+}
+
+template<class Key, class Value, class Compare, class NodeAlloc>
+Value const & PathAVLTree<Key, Value, Compare, NodeAlloc>::operator[](const Key& key) const
+{
+    NodeType* curr = internalFind(key);
+    if(curr == NULL) throw std::out_of_range("Invalid key");
+    return curr->getValue();
+}
+
+template<class Key, class Value, class Compare, class NodeAlloc>
+typename PathAVLTree<Key, Value, Compare, NodeAlloc>::NodeType*
+PathAVLTree<Key, Value, Compare, NodeAlloc>::internalFind(const Key& key) const
+{
+    NodeType* current = root_;
+    while(current != NULL)
+    {
+        int order = compareKeys(key, current->getKey());
+        if(order < 0) current = current->getLeft();
+        else if(order > 0) current = current->getRight();
+        else return current;
+    }
+    return NULL;
+}
+
+/**
+* Orders a against b with one KeyOrder<Compare>::compare() call.
+*/
+template<class Key, class Value, class Compare, class NodeAlloc>
+int PathAVLTree<Key, Value, Compare, NodeAlloc>::compareKeys(const Key& a, const Key& b) const
+{
+    return KeyOrder<Compare>::compare(comp_, a, b);
+}
+
+/**
+* Rotates the subtree at axis toward dir (-1 = left rotation, 1 = right
+* rotation) and returns its new root. Balances are updated for any
+* starting balances, so the same rotation serves insert and remove.
+*/
+template<class Key, class Value, class Compare, class NodeAlloc>
+typename PathAVLTree<Key, Value, Compare, NodeAlloc>::NodeType*
+PathAVLTree<Key, Value, Compare, NodeAlloc>::rotate(NodeType* axis, int dir)
+{
+    NodeType* child = axis->getChild(-dir);
+    axis->setChild(-dir, child->getChild(dir));
+    child->setChild(dir, axis);
+
+    int a = axis->getBalance();
+    int c = child->getBalance();
+    if(dir < 0) // left rotation: child was the right child
+    {
+        a = a - 1 - std::max(c, 0);
+        c = c - 1 + std::min(a, 0);
+    }
+    else
+    {
+        a = a + 1 - std::min(c, 0);
+        c = c + 1 + std::max(a, 0);
+    }
+    axis->setBalance(a);
+    child->setBalance(c);
+    return child;
+}
+
+/**
+* Restores the AVL property at a node whose balance is +2 or -2 with a
+* single or double rotation and returns the subtree's new root.
+*/
+template<class Key, class Value, class Compare, class NodeAlloc>
+typename PathAVLTree<Key, Value, Compare, NodeAlloc>::NodeType*
+PathAVLTree<Key, Value, Compare, NodeAlloc>::rebalance(NodeType* node)
+{
+    if(node->getBalance() == 2)
+    {
+        if(node->getRight()->getBalance() < 0) // zigzag
+        {
+            node->setRight(rotate(node->getRight(), 1));
+        }
+        return rotate(node, -1);
+    }
+    if(node->getLeft()->getBalance() > 0) // zigzag
+    {
+        node->setLeft(rotate(node->getLeft(), -1));
+    }
+    return rotate(node, 1);
+}
+
+/**
+* Hangs child where path[depth] used to be: under path[depth - 1] on the
+* side recorded in dirs, or as the root.
+*/
+template<class Key, class Value, class Compare, class NodeAlloc>
+void PathAVLTree<Key, Value, Compare, NodeAlloc>::replaceChild(NodeType** path, int* dirs, int depth, NodeType* child)
+{
+    if(depth == 0) root_ = child;
+    else path[depth - 1]->setChild(dirs[depth - 1], child);
+}
+
+/**
+* Inserts along a recorded path, then retraces it: each ancestor's balance
+* moves toward the side that grew until one absorbs the growth or a
+* rotation restores the subtree's previous height.
+* Overwrites the value if the key is already in the tree.
+*/
+template<class Key, class Value, class Compare, class NodeAlloc>
+void PathAVLTree<Key, Value, Compare, NodeAlloc>::insert(const std::pair<const Key, Value>& keyValuePair)
+{
+    NodeType* path[MAX_HEIGHT];
+    int dirs[MAX_HEIGHT];
+    int depth = 0;
+
+    NodeType* current = root_;
+    while(current != NULL)
+    {
+        int dir = compareKeys(keyValuePair.first, current->getKey());
+        if(dir == 0)
+        {
+            current->setValue(keyValuePair.second);
+            return;
+        }
+        dir = dir < 0 ? -1 : 1;
+        path[depth] = current;
+        dirs[depth++] = dir;
+        current = current->getChild(dir);
+    }
+
+    NodeType* leaf = alloc_.template create<NodeType>(keyValuePair.first, keyValuePair.second);
+    replaceChild(path, dirs, depth, leaf);
+    ++size_;
+
+    while(depth-- > 0)
+    {
+        NodeType* node = path[depth];
+        node->setBalance(node->getBalance() + dirs[depth]);
+        if(node->getBalance() == 0)
+        {
+            return; // the shorter side caught up
+        }
+        if(node->getBalance() == 2 || node->getBalance() == -2)
+        {
+            replaceChild(path, dirs, depth, rebalance(node));
+            return; // rotation restored the old height
+        }
+    }
+}
+
+/**
+* Removes along a recorded path. A node with two children is replaced by
+* its predecessor, whose path is recorded too, so the retrace starts at the
+* lowest node that lost height and stops once a subtree keeps its height.
+*/
+template<class Key, class Value, class Compare, class NodeAlloc>
+void PathAVLTree<Key, Value, Compare, NodeAlloc>::remove(const Key& key)
+{
+    NodeType* path[MAX_HEIGHT];
+    int dirs[MAX_HEIGHT];
+    int depth = 0;
+
+    NodeType* target = root_;
+    while(target != NULL)
+    {
+        int dir = compareKeys(key, target->getKey());
+        if(dir == 0) break;
+        dir = dir < 0 ? -1 : 1;
+        path[depth] = target;
+        dirs[depth++] = dir;
+        target = target->getChild(dir);
+    }
+    if(target == NULL) // node not in tree
+    {
+        return;
+    }
+
+    if(target->getLeft() != NULL && target->getRight() != NULL)
+    {
+        // the predecessor takes target's place, target's slot in the path
+        int targetDepth = depth;
+        path[depth] = target;
+        dirs[depth++] = -1;
+        NodeType* predec = target->getLeft();
+        while(predec->getRight() != NULL)
+        {
+            path[depth] = predec;
+            dirs[depth++] = 1;
+            predec = predec->getRight();
+        }
+        // unlink predec, which has no right child
+        path[depth - 1]->setChild(dirs[depth - 1], predec->getLeft());
+        predec->setLeft(target->getLeft());
+        predec->setRight(target->getRight());
+        predec->setBalance(target->getBalance());
+        replaceChild(path, dirs, targetDepth, predec);
+        path[targetDepth] = predec;
+    }
+    else
+    {
+        replaceChild(path, dirs, depth, target->getLeft() != NULL ? target->getLeft() : target->getRight());
+    }
+    alloc_.destroy(target);
+    --size_;
+
+    while(depth-- > 0)
+    {
+        NodeType* node = path[depth];
+        node->setBalance(node->getBalance() - dirs[depth]);
+        if(node->getBalance() == 1 || node->getBalance() == -1)
+        {
+            return; // the taller side keeps the height
+        }
+        if(node->getBalance() == 2 || node->getBalance() == -2)
+        {
+            node = rebalance(node);
+            replaceChild(path, dirs, depth, node);
+            if(node->getBalance() != 0)
+            {
+                return; // rotation kept the old height
+            }
+        }
+    }
+}
+
+/**
+* A method to remove all contents of the tree and
+* reset the values in the tree for use again.
+*/
+template<class Key, class Value, class Compare, class NodeAlloc>
+void PathAVLTree<Key, Value, Compare, NodeAlloc>::clear()
+{
+    if(!std::is_trivially_destructible<std::pair<const Key, Value> >::value || !alloc_.reset())
+    {
+        postOrderTraveralClear(root_);
+    }
+    root_ = NULL;
+    size_ = 0;
+}
+
+template<class Key, class Value, class Compare, class NodeAlloc>
+void PathAVLTree<Key, Value, Compare, NodeAlloc>::postOrderTraveralClear(NodeType* curr)
+{
+    if(curr == NULL)
+    {
+        return;
+    }
+    postOrderTraveralClear(curr->getLeft());
+    postOrderTraveralClear(curr->getRight());
+    alloc_.destroy(curr);
+}
+
+/**
+ * Return true iff the tree is balanced.
+ */
+template<class Key, class Value, class Compare, class NodeAlloc>
+bool PathAVLTree<Key, Value, Compare, NodeAlloc>::isBalanced() const
+{
+    bool unbalancedbl = false;
+    calculateHeightIfBalanced(root_, &unbalancedbl);
+    return !unbalancedbl;
+}
+
+template<class Key, class Value, class Compare, class NodeAlloc>
+int PathAVLTree<Key, Value, Compare, NodeAlloc>::calculateHeightIfBalanced(NodeType* root, bool* unbalancedbool) const
+{
+    if(root == NULL) return 0;
+    int leftheight = calculateHeightIfBalanced(root->getLeft(), unbalancedbool) + 1;
+    int rightheight = calculateHeightIfBalanced(root->getRight(), unbalancedbool) + 1;
+    if((leftheight - rightheight > 1) || (leftheight - rightheight < -1))
+    {
+        *unbalancedbool = true;
+    }
+    return std::max(leftheight, rightheight);
+}
+
+#endif
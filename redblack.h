@@ -0,0 +1,460 @@
+#ifndef REDBLACK_H
+#define REDBLACK_H
+
+#include <functional>
+#include "bst.h"
+
+/**
+* A node for a Red-Black tree. The color takes one byte, which lands in
+* the padding after the links, so the node is no larger than an AVLNode.
+* Like AVLNode, it takes the concrete node type as Derived.
+*/
+template <typename Key, typename Value, typename Derived = void>
+class RBNode : public Node<Key, Value, typename NodeSelf<RBNode<Key, Value, Derived>, Derived>::type>
+{
+public:
+    typedef typename NodeSelf<RBNode, Derived>::type NodeType;
+
+    RBNode(const Key& key, const Value& value, NodeType* parent);
+    template<typename... Args>
+    RBNode(EmplaceTag tag, NodeType* parent, Args&&... args);
+
+    bool isRed() const;
+    void setRed(bool red);
+
+protected:
+    bool red_;
+};
+
+/**
+* New nodes are red, as every node is when it is first inserted.
+*/
+template<class Key, class Value, class Derived>
+RBNode<Key, Value, Derived>::RBNode(const Key& key, const Value& value, NodeType* parent) :
+    Node<Key, Value, NodeType>(key, value, parent), red_(true)
+{
+
+}
+
+/**
+* Builds the item in place; see Node.
+*/
+template<class Key, class Value, class Derived>
+template<typename... Args>
+RBNode<Key, Value, Derived>::RBNode(EmplaceTag tag, NodeType* parent, Args&&... args) :
+    Node<Key, Value, NodeType>(tag, parent, std::forward<Args>(args)...), red_(true)
+{
+
+}
+
+template<class Key, class Value, class Derived>
+bool RBNode<Key, Value, Derived>::isRed() const
+{
+    return red_;
+}
+
+template<class Key, class Value, class Derived>
+void RBNode<Key, Value, Derived>::setRed(bool red)
+{
+    red_ = red;
+}
+
+/**
+* A Red-Black tree on the shared BinarySearchTree base. Its balance is
+* looser than an AVLTree's (the height is at most 2 log2(n + 1) rather
+* than about 1.44 log2(n)), so searches may go a level or two deeper,
+* but an insert does at most two rotations and a remove at most three;
+* the rest of the repair is recoloring. An AVL remove may rotate at
+* every level on the way up.
+*
+* isBalanced() checks the AVL height rule, which a Red-Black tree need
+* not meet; isValidRedBlack() checks this tree's own rules.
+*/
+template <class Key, class Value, class Compare = std::less<Key>,
+          class NodeAlloc = NewDeleteNodeAllocator,
+          class NodeType = RBNode<Key, Value> >
+class RedBlackTree : public BinarySearchTree<Key, Value, Compare, NodeAlloc, NodeType>
+{
+public:
+    RedBlackTree();
+    explicit RedBlackTree(const Compare& comp);
+    template<typename ForwardIt>
+    RedBlackTree(ForwardIt first, ForwardIt last, const Compare& comp = Compare());
+
+    virtual void remove(const Key& key) override;
+
+    // true iff the root is black, no red node has a red child, and every
+    // path from a node down to a missing child meets as many black nodes
+    bool isValidRedBlack() const;
+    virtual void setAutoRebalance(double factor) override;   // throws unless factor is 0
+
+protected:
+    virtual void nodeSwap(NodeType* n1, NodeType* n2) override;
+    virtual void balanceAfterInsert(NodeType* leaf) override;
+    virtual void setBuiltBalance(NodeType* node, int balance, size_t leftCount, size_t rightCount) override;
+
+    void removeFix(NodeType* node, NodeType* parent);
+    void rotateLeft(NodeType* axis);
+    void rotateRight(NodeType* axis);
+    static bool isRed(NodeType* node);
+    static size_t builtBlackHeight(size_t count);
+    static int blackHeight(NodeType* node, bool& valid);
+};
+
+template<class Key, class Value, class Compare, class NodeAlloc, class NodeType>
+RedBlackTree<Key, Value, Compare, NodeAlloc, NodeType>::RedBlackTree()
+{
+
+}
+
+template<class Key, class Value, class Compare, class NodeAlloc, class NodeType>
+RedBlackTree<Key, Value, Compare, NodeAlloc, NodeType>::RedBlackTree(const Compare& comp) :
+    BinarySearchTree<Key, Value, Compare, NodeAlloc, NodeType>(comp)
+{
+
+}
+
+/**
+* Bulk loads [first, last) in O(n) when it is sorted; see
+* BinarySearchTree::assign(). The colors are set as the tree is built.
+*/
+template<class Key, class Value, class Compare, class NodeAlloc, class NodeType>
+template<typename ForwardIt>
+RedBlackTree<Key, Value, Compare, NodeAlloc, NodeType>::RedBlackTree(ForwardIt first, ForwardIt last, const Compare& comp) :
+    BinarySearchTree<Key, Value, Compare, NodeAlloc, NodeType>(comp)
+{
+    this->assign(first, last);
+}
+
+/**
+* A missing child counts as black.
+*/
+template<class Key, class Value, class Compare, class NodeAlloc, class NodeType>
+bool RedBlackTree<Key, Value, Compare, NodeAlloc, NodeType>::isRed(NodeType* node)
+{
+    return node != NULL && node->isRed();
+}
+
+/**
+* The black height of a subtree of count nodes built by assign() or
+* rebalance(), with every level black except an incomplete bottom one:
+* floor(log2(count + 1)).
+*/
+template<class Key, class Value, class Compare, class NodeAlloc, class NodeType>
+size_t RedBlackTree<Key, Value, Compare, NodeAlloc, NodeType>::builtBlackHeight(size_t count)
+{
+    size_t height = 0;
+    for (++count; count > 1; count >>= 1)
+    {
+        ++height;
+    }
+    return height;
+}
+
+/**
+* assign() and rebalance() give the left subtree any extra nodes. When
+* that makes it a perfect tree one black level taller than the right
+* subtree, its root is made red; its children are black, as in every
+* perfect built subtree.
+*/
+template<class Key, class Value, class Compare, class NodeAlloc, class NodeType>
+void RedBlackTree<Key, Value, Compare, NodeAlloc, NodeType>::setBuiltBalance(NodeType* node, int, size_t leftCount, size_t rightCount)
+{
+    node->setRed(false);
+    if (builtBlackHeight(leftCount) > builtBlackHeight(rightCount))
+    {
+        node->getLeft()->setRed(true);
+    }
+}
+
+template<class Key, class Value, class Compare, class NodeAlloc, class NodeType>
+void RedBlackTree<Key, Value, Compare, NodeAlloc, NodeType>::rotateLeft(NodeType* axis)
+{
+    NodeType* child = axis->getRight();
+    NodeType* parent = axis->getParent();
+    axis->setRight(child->getLeft());
+    if (child->getLeft() != NULL)
+    {
+        child->getLeft()->setParent(axis);
+    }
+    child->setParent(parent);
+    if (parent == NULL)
+    {
+        this->root_ = child;
+    }
+    else if (parent->getLeft() == axis)
+    {
+        parent->setLeft(child);
+    }
+    else
+    {
+        parent->setRight(child);
+    }
+    child->setLeft(axis);
+    axis->setParent(child);
+    this->refreshNode(axis);
+    this->refreshNode(child);
+}
+
+template<class Key, class Value, class Compare, class NodeAlloc, class NodeType>
+void RedBlackTree<Key, Value, Compare, NodeAlloc, NodeType>::rotateRight(NodeType* axis)
+{
+    NodeType* child = axis->getLeft();
+    NodeType* parent = axis->getParent();
+    axis->setLeft(child->getRight());
+    if (child->getRight() != NULL)
+    {
+        child->getRight()->setParent(axis);
+    }
+    child->setParent(parent);
+    if (parent == NULL)
+    {
+        this->root_ = child;
+    }
+    else if (parent->getLeft() == axis)
+    {
+        parent->setLeft(child);
+    }
+    else
+    {
+        parent->setRight(child);
+    }
+    child->setRight(axis);
+    axis->setParent(child);
+    this->refreshNode(axis);
+    this->refreshNode(child);
+}
+
+/*
+ * The coloring rules already hold the height under 2 log2(n + 1).
+ */
+template<class Key, class Value, class Compare, class NodeAlloc, class NodeType>
+void RedBlackTree<Key, Value, Compare, NodeAlloc, NodeType>::setAutoRebalance(double factor)
+{
+    if (factor != 0)
+    {
+        throw std::logic_error("setAutoRebalance: a RedBlackTree keeps its own balance");
+    }
+}
+
+/*
+ * Insertion itself is shared with BinarySearchTree; the new leaf is red,
+ * so the only rule it can break is a red parent. A red uncle is fixed by
+ * recoloring and the check moves up two levels; a black uncle by one or
+ * two rotations, after which the loop ends.
+ */
+template<class Key, class Value, class Compare, class NodeAlloc, class NodeType>
+void RedBlackTree<Key, Value, Compare, NodeAlloc, NodeType>::balanceAfterInsert(NodeType* leaf)
+{
+    NodeType* node = leaf;
+    NodeType* parent;
+    while ((parent = node->getParent()) != NULL && parent->isRed())
+    {
+        NodeType* grandparent = parent->getParent(); // exists, as the root is black
+        bool parentIsLeft = grandparent->getLeft() == parent;
+        NodeType* uncle = parentIsLeft ? grandparent->getRight() : grandparent->getLeft();
+        if (isRed(uncle))
+        {
+            parent->setRed(false);
+            uncle->setRed(false);
+            grandparent->setRed(true);
+            node = grandparent;
+            continue;
+        }
+        if (parentIsLeft)
+        {
+            if (parent->getRight() == node)
+            {
+                rotateLeft(parent);
+                parent = node;
+            }
+            rotateRight(grandparent);
+        }
+        else
+        {
+            if (parent->getLeft() == node)
+            {
+                rotateRight(parent);
+                parent = node;
+            }
+            rotateLeft(grandparent);
+        }
+        parent->setRed(false);
+        grandparent->setRed(true);
+        break;
+    }
+    this->root_->setRed(false);
+}
+
+/*
+ * A node with two children is first swapped with its predecessor, as in
+ * BinarySearchTree::remove(). Unlinking a red node, or a black node with
+ * a red child that can turn black in its place, needs no repair.
+ */
+template<class Key, class Value, class Compare, class NodeAlloc, class NodeType>
+void RedBlackTree<Key, Value, Compare, NodeAlloc, NodeType>::remove(const Key& key)
+{
+    NodeType* node = this->internalFind(key);
+    if (node == NULL)
+    {
+        return;
+    }
+    if (node->getLeft() != NULL && node->getRight() != NULL)
+    {
+        nodeSwap(node, this->predecessor(node));
+    }
+    this->detachBookkeeping(node);
+    NodeType* parent = node->getParent();
+    NodeType* child = node->getLeft() != NULL ? node->getLeft() : node->getRight();
+    if (child != NULL)
+    {
+        this->promote(child);
+    }
+    else if (parent == NULL)
+    {
+        this->root_ = NULL;
+    }
+    else if (parent->getLeft() == node)
+    {
+        parent->setLeft(NULL);
+    }
+    else
+    {
+        parent->setRight(NULL);
+    }
+    bool wasRed = node->isRed();
+    this->alloc_.destroy(node);
+    this->refreshPath(parent); // before removeFix, whose rotations read the children
+
+    if (wasRed)
+    {
+        return;
+    }
+    if (isRed(child))
+    {
+        child->setRed(false);
+        return;
+    }
+    removeFix(child, parent);
+}
+
+/**
+* Restores the black height after a black node was unlinked above node
+* (NULL for a missing child), whose parent is parent: node's side is one
+* black short. A black sibling with black children is recolored red and
+* the shortage moves up; any other case ends after at most three
+* rotations in total.
+*/
+template<class Key, class Value, class Compare, class NodeAlloc, class NodeType>
+void RedBlackTree<Key, Value, Compare, NodeAlloc, NodeType>::removeFix(NodeType* node, NodeType* parent)
+{
+    while (parent != NULL && !isRed(node))
+    {
+        if (parent->getLeft() == node)
+        {
+            NodeType* sibling = parent->getRight(); // the black height makes it exist
+            if (sibling->isRed())
+            {
+                sibling->setRed(false);
+                parent->setRed(true);
+                rotateLeft(parent);
+                sibling = parent->getRight();
+            }
+            if (!isRed(sibling->getLeft()) && !isRed(sibling->getRight()))
+            {
+                sibling->setRed(true);
+                node = parent;
+                parent = node->getParent();
+                continue;
+            }
+            if (!isRed(sibling->getRight()))
+            {
+                sibling->getLeft()->setRed(false);
+                sibling->setRed(true);
+                rotateRight(sibling);
+                sibling = parent->getRight();
+            }
+            sibling->setRed(parent->isRed());
+            parent->setRed(false);
+            sibling->getRight()->setRed(false);
+            rotateLeft(parent);
+        }
+        else
+        {
+            NodeType* sibling = parent->getLeft();
+            if (sibling->isRed())
+            {
+                sibling->setRed(false);
+                parent->setRed(true);
+                rotateRight(parent);
+                sibling = parent->getLeft();
+            }
+            if (!isRed(sibling->getLeft()) && !isRed(sibling->getRight()))
+            {
+                sibling->setRed(true);
+                node = parent;
+                parent = node->getParent();
+                continue;
+            }
+            if (!isRed(sibling->getLeft()))
+            {
+                sibling->getRight()->setRed(false);
+                sibling->setRed(true);
+                rotateLeft(sibling);
+                sibling = parent->getLeft();
+            }
+            sibling->setRed(parent->isRed());
+            parent->setRed(false);
+            sibling->getLeft()->setRed(false);
+            rotateRight(parent);
+        }
+        return;
+    }
+    if (node != NULL)
+    {
+        node->setRed(false);
+    }
+}
+
+template<class Key, class Value, class Compare, class NodeAlloc, class NodeType>
+void RedBlackTree<Key, Value, Compare, NodeAlloc, NodeType>::nodeSwap(NodeType* n1, NodeType* n2)
+{
+    BinarySearchTree<Key, Value, Compare, NodeAlloc, NodeType>::nodeSwap(n1, n2);
+    bool red = n1->isRed();
+    n1->setRed(n2->isRed());
+    n2->setRed(red);
+}
+
+template<class Key, class Value, class Compare, class NodeAlloc, class NodeType>
+bool RedBlackTree<Key, Value, Compare, NodeAlloc, NodeType>::isValidRedBlack() const
+{
+    bool valid = !isRed(this->root_);
+    blackHeight(this->root_, valid);
+    return valid;
+}
+
+/**
+* The black nodes on the left spine below node, clearing valid if any
+* rule is broken within its subtree.
+*/
+template<class Key, class Value, class Compare, class NodeAlloc, class NodeType>
+int RedBlackTree<Key, Value, Compare, NodeAlloc, NodeType>::blackHeight(NodeType* node, bool& valid)
+{
+    if (node == NULL)
+    {
+        return 0;
+    }
+    if (node->isRed() && (isRed(node->getLeft()) || isRed(node->getRight())))
+    {
+        valid = false;
+    }
+    int left = blackHeight(node->getLeft(), valid);
+    int right = blackHeight(node->getRight(), valid);
+    if (left != right)
+    {
+        valid = false;
+    }
+    return left + (node->isRed() ? 0 : 1);
+}
+
+#endif
@@ -0,0 +1,391 @@
+#ifndef SMALL_TREE_H
+#define SMALL_TREE_H
+
+#include <cstddef>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include "avlbst.h"
+
+/**
+* A map that keeps up to InlineCapacity items in a sorted array inside the
+* object itself and only moves them into a Tree (any BinarySearchTree,
+* AVLTree by default) when one more distinct key arrives. Tiny maps then
+* cost no heap allocations and are searched by binary search over one
+* contiguous array. Once promoted, the map stays a tree until clear().
+*
+* The interface and iterator behave like BinarySearchTree's. Any insert
+* or remove invalidates iterators while the items are inline.
+*/
+template <typename Key, typename Value, size_t InlineCapacity = 16,
+          typename Tree = AVLTree<Key, Value> >
+class SmallTree
+{
+public:
+    typedef std::pair<const Key, Value> ItemType;
+
+    SmallTree();
+    ~SmallTree();
+    void insert(const ItemType& keyValuePair);
+    void remove(const Key& key);
+    void clear();
+    bool isBalanced() const;
+    bool empty() const;
+    size_t size() const;
+    bool isInline() const;
+
+    /**
+    * Walks the inline array or, once promoted, wraps the tree's iterator.
+    */
+    class iterator
+    {
+    public:
+        iterator();
+
+        ItemType& operator*() const;
+        ItemType* operator->() const;
+
+        bool operator==(const iterator& rhs) const;
+        bool operator!=(const iterator& rhs) const;
+
+        iterator& operator++();
+
+    protected:
+        friend class SmallTree<Key, Value, InlineCapacity, Tree>;
+        iterator(ItemType* item, ItemType* last);
+        iterator(const typename Tree::iterator& treeIt);
+
+        ItemType* item_;   // NULL when iterating the tree or at the end
+        ItemType* last_;
+        typename Tree::iterator treeIt_;
+    };
+
+    iterator begin() const;
+    iterator end() const;
+    iterator find(const Key& key) const;
+    Value& operator[](const Key& key);
+    Value const & operator[](const Key& key) const;
+
+private:
+    // Copies would have to duplicate the tree, which does not support it.
+    SmallTree(const SmallTree&);
+    SmallTree& operator=(const SmallTree&);
+
+    ItemType* item(size_t i) const;
+    bool less(const Key& a, const Key& b) const;
+    size_t lowerBound(const Key& key) const;
+    ItemType* inlineFind(const Key& key) const;
+    void promote();
+    void destroyInline();
+
+    typename std::aligned_storage<sizeof(ItemType), alignof(ItemType)>::type items_[InlineCapacity];
+    size_t count_;     // items in the inline array
+    bool promoted_;    // items live in tree_ instead
+    Tree tree_;
+};
+
+/*
+-------------------------------------------------------
+Begin implementations for the SmallTree::iterator class.
+-------------------------------------------------------
+*/
+
+template<class Key, class Value, size_t InlineCapacity, class Tree>
+SmallTree<Key, Value, InlineCapacity, Tree>::iterator::iterator() :
+    item_(NULL),
+    last_(NULL)
+{
+
+}
+
+template<class Key, class Value, size_t InlineCapacity, class Tree>
+SmallTree<Key, Value, InlineCapacity, Tree>::iterator::iterator(ItemType* item, ItemType* last) :
+    item_(item),
+    last_(last)
+{
+
+}
+
+template<class Key, class Value, size_t InlineCapacity, class Tree>
+SmallTree<Key, Value, InlineCapacity, Tree>::iterator::iterator(const typename Tree::iterator& treeIt) :
+    item_(NULL),
+    last_(NULL),
+    treeIt_(treeIt)
+{
+
+}
+
+template<class Key, class Value, size_t InlineCapacity, class Tree>
+std::pair<const Key, Value>&
+SmallTree<Key, Value, InlineCapacity, Tree>::iterator::operator*() const
+{
+    return item_ != NULL ? *item_ : *treeIt_;
+}
+
+template<class Key, class Value, size_t InlineCapacity, class Tree>
+std::pair<const Key, Value>*
+SmallTree<Key, Value, InlineCapacity, Tree>::iterator::operator->() const
+{
+    return item_ != NULL ? item_ : &(*treeIt_);
+}
+
+template<class Key, class Value, size_t InlineCapacity, class Tree>
+bool
+SmallTree<Key, Value, InlineCapacity, Tree>::iterator::operator==(const iterator& rhs) const
+{
+    return item_ == rhs.item_ && treeIt_ == rhs.treeIt_;
+}
+
+template<class Key, class Value, size_t InlineCapacity, class Tree>
+bool
+SmallTree<Key, Value, InlineCapacity, Tree>::iterator::operator!=(const iterator& rhs) const
+{
+    return !(*this == rhs);
+}
+
+template<class Key, class Value, size_t InlineCapacity, class Tree>
+typename SmallTree<Key, Value, InlineCapacity, Tree>::iterator&
+SmallTree<Key, Value, InlineCapacity, Tree>::iterator::operator++()
+{
+    if(item_ != NULL)
+    {
+        item_ = (item_ == last_) ? NULL : item_ + 1;
+    }
+    else
+    {
+        ++treeIt_;
+    }
+    return *this;
+}
+
+/*
+-----------------------------------------------------
+End implementations for the SmallTree::iterator class.
+-----------------------------------------------------
+*/
+
+template<class Key, class Value, size_t InlineCapacity, class Tree>
+SmallTree<Key, Value, InlineCapacity, Tree>::SmallTree() :
+    count_(0),
+    promoted_(false)
+{
+
+}
+
+template<class Key, class Value, size_t InlineCapacity, class Tree>
+SmallTree<Key, Value, InlineCapacity, Tree>::~SmallTree()
+{
+    destroyInline();
+}
+
+template<class Key, class Value, size_t InlineCapacity, class Tree>
+bool SmallTree<Key, Value, InlineCapacity, Tree>::empty() const
+{
+    return promoted_ ? tree_.empty() : count_ == 0;
+}
+
+template<class Key, class Value, size_t InlineCapacity, class Tree>
+size_t SmallTree<Key, Value, InlineCapacity, Tree>::size() const
+{
+    return promoted_ ? tree_.size() : count_;
+}
+
+/**
+* True while the items are still held in the inline array.
+*/
+template<class Key, class Value, size_t InlineCapacity, class Tree>
+bool SmallTree<Key, Value, InlineCapacity, Tree>::isInline() const
+{
+    return !promoted_;
+}
+
+template<class Key, class Value, size_t InlineCapacity, class Tree>
+bool SmallTree<Key, Value, InlineCapacity, Tree>::isBalanced() const
+{
+    return promoted_ ? tree_.isBalanced() : true;
+}
+
+template<class Key, class Value, size_t InlineCapacity, class Tree>
+typename SmallTree<Key, Value, InlineCapacity, Tree>::iterator
+SmallTree<Key, Value, InlineCapacity, Tree>::begin() const
+{
+    if(promoted_) return iterator(tree_.begin());
+    if(count_ == 0) return end();
+    return iterator(item(0), item(count_ - 1));
+}
+
+template<class Key, class Value, size_t InlineCapacity, class Tree>
+typename SmallTree<Key, Value, InlineCapacity, Tree>::iterator
+SmallTree<Key, Value, InlineCapacity, Tree>::end() const
+{
+    return iterator(tree_.end());
+}
+
+template<class Key, class Value, size_t InlineCapacity, class Tree>
+typename SmallTree<Key, Value, InlineCapacity, Tree>::iterator
+SmallTree<Key, Value, InlineCapacity, Tree>::find(const Key& key) const
+{
+    if(promoted_) return iterator(tree_.find(key));
+    ItemType* found = inlineFind(key);
+    if(found == NULL) return end();
+    return iterator(found, item(count_ - 1));
+}
+
+/**
+ * @precondition The key exists in the map
+ * Returns the value associated with the key
+ */
+template<class Key, class Value, size_t InlineCapacity, class Tree>
+Value& SmallTree<Key, Value, InlineCapacity, Tree>::operator[](const Key& key)
+{
+    if(promoted_) return tree_[key];
+    ItemType* found = inlineFind(key);
+    if(found == NULL) throw std::out_of_range("Invalid key");
+    return found->second;
+}
+
+template<class Key, class Value, size_t InlineCapacity, class Tree>
+Value const & SmallTree<Key, Value, InlineCapacity, Tree>::operator[](const Key& key) const
+{
+    if(promoted_) return tree_[key];
+    ItemType* found = inlineFind(key);
+    if(found == NULL) throw std::out_of_range("Invalid key");
+    return found->second;
+}
+
+/**
+* Inserts into the sorted array, shifting larger items up one slot, or
+* overwrites the value if the key is present. A full array is promoted
+* to the tree first.
+*/
+template<class Key, class Value, size_t InlineCapacity, class Tree>
+void SmallTree<Key, Value, InlineCapacity, Tree>::insert(const ItemType& keyValuePair)
+{
+    if(promoted_)
+    {
+        tree_.insert(keyValuePair);
+        return;
+    }
+    size_t pos = lowerBound(keyValuePair.first);
+    if(pos < count_ && !less(keyValuePair.first, item(pos)->first))
+    {
+        item(pos)->second = keyValuePair.second;
+        return;
+    }
+    if(count_ == InlineCapacity)
+    {
+        promote();
+        tree_.insert(keyValuePair);
+        return;
+    }
+    // keys are const, so shifting is move-construct then destroy
+    for(size_t i = count_; i > pos; --i)
+    {
+        new (item(i)) ItemType(std::move(*item(i - 1)));
+        item(i - 1)->~ItemType();
+    }
+    new (item(pos)) ItemType(keyValuePair);
+    ++count_;
+}
+
+template<class Key, class Value, size_t InlineCapacity, class Tree>
+void SmallTree<Key, Value, InlineCapacity, Tree>::remove(const Key& key)
+{
+    if(promoted_)
+    {
+        tree_.remove(key);
+        return;
+    }
+    size_t pos = lowerBound(key);
+    if(pos == count_ || less(key, item(pos)->first)) // node not in tree
+    {
+        return;
+    }
+    item(pos)->~ItemType();
+    for(size_t i = pos + 1; i < count_; ++i)
+    {
+        new (item(i - 1)) ItemType(std::move(*item(i)));
+        item(i)->~ItemType();
+    }
+    --count_;
+}
+
+/**
+* Removes all contents and returns to inline storage.
+*/
+template<class Key, class Value, size_t InlineCapacity, class Tree>
+void SmallTree<Key, Value, InlineCapacity, Tree>::clear()
+{
+    destroyInline();
+    tree_.clear();
+    promoted_ = false;
+}
+
+template<class Key, class Value, size_t InlineCapacity, class Tree>
+std::pair<const Key, Value>* SmallTree<Key, Value, InlineCapacity, Tree>::item(size_t i) const
+{
+    return reinterpret_cast<ItemType*>(const_cast<typename std::aligned_storage<sizeof(ItemType), alignof(ItemType)>::type*>(&items_[i]));
+}
+
+/**
+* Orders the inline items by the tree's own comparator.
+*/
+template<class Key, class Value, size_t InlineCapacity, class Tree>
+bool SmallTree<Key, Value, InlineCapacity, Tree>::less(const Key& a, const Key& b) const
+{
+    return tree_.key_comp()(a, b);
+}
+
+/**
+* Index of the first inline item whose key is not less than key.
+*/
+template<class Key, class Value, size_t InlineCapacity, class Tree>
+size_t SmallTree<Key, Value, InlineCapacity, Tree>::lowerBound(const Key& key) const
+{
+    size_t lo = 0;
+    size_t hi = count_;
+    while(lo < hi)
+    {
+        size_t mid = (lo + hi) / 2;
+        if(less(item(mid)->first, key)) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+template<class Key, class Value, size_t InlineCapacity, class Tree>
+std::pair<const Key, Value>* SmallTree<Key, Value, InlineCapacity, Tree>::inlineFind(const Key& key) const
+{
+    size_t pos = lowerBound(key);
+    if(pos == count_ || less(key, item(pos)->first)) return NULL;
+    return item(pos);
+}
+
+/**
+* Copies every inline item into the tree, then drops the inline ones. The
+* array is sorted, so assign() links the tree in one linear pass. It
+* creates every node before linking any and destroys them all if one
+* throws, so a failure leaves tree_ empty and the map inline. The items
+* are copied rather than moved because a node allocation can fail after
+* earlier items were moved into nodes that are then freed.
+*/
+template<class Key, class Value, size_t InlineCapacity, class Tree>
+void SmallTree<Key, Value, InlineCapacity, Tree>::promote()
+{
+    tree_.assign(item(0), item(0) + count_);
+    destroyInline();
+    promoted_ = true;
+}
+
+template<class Key, class Value, size_t InlineCapacity, class Tree>
+void SmallTree<Key, Value, InlineCapacity, Tree>::destroyInline()
+{
+    for(size_t i = 0; i < count_; ++i)
+    {
+        item(i)->~ItemType();
+    }
+    count_ = 0;
+}
+
+#endif
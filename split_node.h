@@ -0,0 +1,214 @@
+#ifndef SPLIT_NODE_H
+#define SPLIT_NODE_H
+
+#include <utility>
+#include "node_alloc.h"
+
+// Included from bst.h after the Node class; relies on NodeSelf and EmplaceTag.
+
+/**
+* A Node that keeps only what a search touches - a copy of the key and
+* the links - and points at its item, which lives out of line in a
+* separate value pool. Large values then never share cache lines with
+* the keys being compared. getItem() still returns the full pair, so
+* iterators behave exactly as with Node.
+* Nodes must be created by SplitNodeAllocator, which attaches the item.
+*/
+template <typename Key, typename Value, typename Derived = void>
+class SplitNode
+{
+public:
+    typedef typename NodeSelf<SplitNode, Derived>::type NodeType;
+    typedef std::pair<const Key, Value> ItemType;
+
+    SplitNode(const Key& key, ItemType* item, NodeType* parent);
+
+    const ItemType& getItem() const;
+    ItemType& getItem();
+    const Key& getKey() const;
+    const Value& getValue() const;
+    Value& getValue();
+
+    NodeType* getParent() const;
+    NodeType* getLeft() const;
+    NodeType* getRight() const;
+
+    void setParent(NodeType* parent);
+    void setLeft(NodeType* left);
+    void setRight(NodeType* right);
+    void setValue(const Value &value);
+
+protected:
+    Key key_;
+    NodeType* parent_;
+    NodeType* left_;
+    NodeType* right_;
+    ItemType* item_;
+};
+
+template<typename Key, typename Value, typename Derived>
+SplitNode<Key, Value, Derived>::SplitNode(const Key& key, ItemType* item, NodeType* parent) :
+    key_(key),
+    parent_(parent),
+    left_(NULL),
+    right_(NULL),
+    item_(item)
+{
+
+}
+
+template<typename Key, typename Value, typename Derived>
+const std::pair<const Key, Value>& SplitNode<Key, Value, Derived>::getItem() const
+{
+    return *item_;
+}
+
+template<typename Key, typename Value, typename Derived>
+std::pair<const Key, Value>& SplitNode<Key, Value, Derived>::getItem()
+{
+    return *item_;
+}
+
+/**
+* Reads the inline copy, so comparisons never touch the item.
+*/
+template<typename Key, typename Value, typename Derived>
+const Key& SplitNode<Key, Value, Derived>::getKey() const
+{
+    return key_;
+}
+
+template<typename Key, typename Value, typename Derived>
+const Value& SplitNode<Key, Value, Derived>::getValue() const
+{
+    return item_->second;
+}
+
+template<typename Key, typename Value, typename Derived>
+Value& SplitNode<Key, Value, Derived>::getValue()
+{
+    return item_->second;
+}
+
+template<typename Key, typename Value, typename Derived>
+typename SplitNode<Key, Value, Derived>::NodeType* SplitNode<Key, Value, Derived>::getParent() const
+{
+    return parent_;
+}
+
+template<typename Key, typename Value, typename Derived>
+typename SplitNode<Key, Value, Derived>::NodeType* SplitNode<Key, Value, Derived>::getLeft() const
+{
+    return left_;
+}
+
+template<typename Key, typename Value, typename Derived>
+typename SplitNode<Key, Value, Derived>::NodeType* SplitNode<Key, Value, Derived>::getRight() const
+{
+    return right_;
+}
+
+template<typename Key, typename Value, typename Derived>
+void SplitNode<Key, Value, Derived>::setParent(NodeType* parent)
+{
+    parent_ = parent;
+}
+
+template<typename Key, typename Value, typename Derived>
+void SplitNode<Key, Value, Derived>::setLeft(NodeType* left)
+{
+    left_ = left;
+}
+
+template<typename Key, typename Value, typename Derived>
+void SplitNode<Key, Value, Derived>::setRight(NodeType* right)
+{
+    right_ = right;
+}
+
+template<typename Key, typename Value, typename Derived>
+void SplitNode<Key, Value, Derived>::setValue(const Value& value)
+{
+    item_->second = value;
+}
+
+/**
+* The allocation policy for SplitNode trees. Nodes and their items come
+* from two separate instances of Policy, so with NodePool the hot nodes
+* are packed together in one set of chunks and the items in another.
+*/
+template <typename Policy = NodePool<> >
+class SplitNodeAllocator
+{
+public:
+    template<typename NodeType, typename Parent>
+    NodeType* create(const typename NodeType::ItemType::first_type& key,
+                     const typename NodeType::ItemType::second_type& value,
+                     Parent parent)
+    {
+        typedef typename NodeType::ItemType ItemType;
+        ItemType* item = values_.template create<ItemType>(key, value);
+        try
+        {
+            return nodes_.template create<NodeType>(key, item, parent);
+        }
+        catch(...)
+        {
+            values_.destroy(item);
+            throw;
+        }
+    }
+
+    // The item is built in place and the node copies the key from it.
+    template<typename NodeType, typename... Args>
+    NodeType* create(EmplaceTag, NodeType* parent, Args&&... args)
+    {
+        typedef typename NodeType::ItemType ItemType;
+        ItemType* item = values_.template create<ItemType>(std::forward<Args>(args)...);
+        try
+        {
+            return nodes_.template create<NodeType>(item->first, item, parent);
+        }
+        catch(...)
+        {
+            values_.destroy(item);
+            throw;
+        }
+    }
+
+    template<typename NodeType>
+    void destroy(NodeType* node)
+    {
+        values_.destroy(&node->getItem());
+        nodes_.destroy(node);
+    }
+
+    // Both pools are the same policy, so they agree on bulk reclaiming.
+    bool reset()
+    {
+        return nodes_.reset() && values_.reset();
+    }
+
+    // Compaction moves the hot nodes only; items stay where they are.
+    template<typename NodeType>
+    NodeType* beginCompact(size_t count)
+    {
+        return nodes_.template beginCompact<NodeType>(count);
+    }
+
+    void endCompact(void* block, size_t count)
+    {
+        nodes_.endCompact(block, count);
+    }
+
+    void abortCompact(void* block)
+    {
+        nodes_.abortCompact(block);
+    }
+
+private:
+    Policy nodes_;
+    Policy values_;
+};
+
+#endif
@@ -0,0 +1,167 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+* A fixed set of worker threads for fork-join work, such as the AVLTree
+* set operations. runBoth(first, second) offers first to the workers,
+* runs second on the calling thread and then waits for first. While it
+* waits, the caller runs queued tasks itself, its own first included,
+* so nested runBoth() calls never leave every thread blocked.
+*/
+class ThreadPool
+{
+public:
+    // threads counts the caller, so ThreadPool(1) starts no workers
+    explicit ThreadPool(unsigned threads = std::thread::hardware_concurrency());
+    ~ThreadPool();
+
+    template<typename F, typename G>
+    void runBoth(F&& first, G&& second);
+    unsigned size() const;
+
+private:
+    ThreadPool(const ThreadPool&);
+    ThreadPool& operator=(const ThreadPool&);
+
+    struct Task
+    {
+        std::function<void()> run;
+        bool done;
+        std::exception_ptr error;
+    };
+
+    void work();
+    void execute(Task* task);
+    void waitFor(Task& task);
+
+    std::vector<std::thread> workers_;
+    std::deque<Task*> queue_;   // workers take the oldest, waiters the newest
+    std::mutex mutex_;
+    std::condition_variable changed_;
+    bool stopping_;
+};
+
+inline ThreadPool::ThreadPool(unsigned threads) :
+    stopping_(false)
+{
+    for(unsigned i = 1; i < threads; ++i)
+    {
+        workers_.push_back(std::thread(&ThreadPool::work, this));
+    }
+}
+
+inline ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    changed_.notify_all();
+    for(size_t i = 0; i < workers_.size(); ++i)
+    {
+        workers_[i].join();
+    }
+}
+
+inline unsigned ThreadPool::size() const
+{
+    return static_cast<unsigned>(workers_.size()) + 1;
+}
+
+/**
+* Runs first and second, possibly at the same time, and returns once
+* both have finished. An exception from either is rethrown here, after
+* both are done.
+*/
+template<typename F, typename G>
+void ThreadPool::runBoth(F&& first, G&& second)
+{
+    Task task;
+    task.run = std::forward<F>(first);
+    task.done = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        queue_.push_back(&task);
+    }
+    changed_.notify_one();
+    try
+    {
+        second();
+    }
+    catch(...)
+    {
+        waitFor(task); // task lives in this frame
+        throw;
+    }
+    waitFor(task);
+    if(task.error)
+    {
+        std::rethrow_exception(task.error);
+    }
+}
+
+inline void ThreadPool::work()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    for(;;)
+    {
+        changed_.wait(lock, [this] { return stopping_ || !queue_.empty(); });
+        if(queue_.empty())
+        {
+            return; // stopping
+        }
+        Task* task = queue_.front();
+        queue_.pop_front();
+        lock.unlock();
+        execute(task);
+        lock.lock();
+    }
+}
+
+inline void ThreadPool::execute(Task* task)
+{
+    try
+    {
+        task->run();
+    }
+    catch(...)
+    {
+        task->error = std::current_exception();
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        task->done = true;
+    }
+    changed_.notify_all();
+}
+
+/**
+* Blocks until task is done, running queued tasks in the meantime.
+*/
+inline void ThreadPool::waitFor(Task& task)
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    while(!task.done)
+    {
+        if(queue_.empty())
+        {
+            changed_.wait(lock);
+            continue;
+        }
+        Task* next = queue_.back();
+        queue_.pop_back();
+        lock.unlock();
+        execute(next);
+        lock.lock();
+    }
+}
+
+#endif